@@ -0,0 +1,75 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2018 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <libini/ini.h>
+
+/* returns the bytes reserved but not used */
+static size_t print_usage(INI* ini, const char* when)
+{
+	INI_MEMORY_USAGE usage;
+	ini_memory_usage(ini, &usage);
+	printf("%s: %zu bytes used, %zu reserved\n", when, usage.total_used,
+		usage.total_reserved);
+	return usage.total_reserved - usage.total_used;
+}
+
+int main()
+{
+	INI* ini = ini_create();
+	char name[INI_STR_MAX_LENGTH];
+	for (int i = 0; i < 100; i++) {
+		snprintf(name, INI_STR_MAX_LENGTH, "key%d", i);
+		ini_add_key_i(ini, "Numbers", name, i);
+	}
+	int primes[] = { 2, 3, 5, 7, 11 };
+	ini_add_key_iv(ini, "Arrays", "primes", primes, 5);
+	ini_add_key_iv(ini, "Arrays", "empty", NULL, 0);
+
+	print_usage(ini, "separate allocations");
+	ini_compact(ini);
+	size_t waste = print_usage(ini, "compacted");
+	/* at most the 8 bytes alignment of each record, names included */
+	assert(waste < 8 * (2 + 2 + 102 + 2));
+
+	/* lookups work the same on a compacted ini */
+	size_t count;
+	const int* vals = ini_get_key_iv(ini, "Arrays", "primes", &count);
+	assert(count == 5 && vals[4] == 11);
+	ini_get_key_iv(ini, "Arrays", "empty", &count);
+	assert(count == 0);
+	INI_FINGERPRINT fp = ini_fingerprint(ini);
+
+	/* any change unpacks it again, vals must be fetched anew */
+	ini_add_key_i(ini, "Numbers", "key100", 100);
+	print_usage(ini, "after a change");
+	vals = ini_get_key_iv(ini, "Arrays", "primes", &count);
+	assert(count == 5 && vals[0] == 2);
+	ini_remove_key(ini, "Numbers", "key100");
+	assert(ini_fingerprint(ini) == fp);
+
+	ini_destroy(ini);
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2018 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <libini/ini.h>
+
+static const char* kind_name(int kind)
+{
+	switch (kind) {
+		case INI_DIFF_ADDED: return "added";
+		case INI_DIFF_REMOVED: return "removed";
+		default: return "changed";
+	}
+}
+
+int main()
+{
+	INI* old_conf = ini_create();
+	ini_add_key_i(old_conf, "Server", "port", 8080);
+	ini_add_key_i(old_conf, "Server", "workers", 4);
+	ini_add_key_str(old_conf, "Server", "debug", "yes");
+	ini_add_key_f(old_conf, "Balancer", "epsilon", 0.5f);
+
+	INI* new_conf = ini_create();
+	ini_add_key_i(new_conf, "Server", "port", 9090);
+	ini_add_key_i(new_conf, "Server", "workers", 4);
+	float weights[] = { 0.25f, 0.75f };
+	ini_add_key_fv(new_conf, "Balancer", "weights", weights, 2);
+	/* values which only survive a lossless diff */
+	ini_add_key_f(new_conf, "Balancer", "epsilon", 1e-7f);
+	ini_add_key_str(new_conf, "Balancer", "retries", "10");
+	ini_add_key_str(new_conf, "Balancer", "ratio", "0.5");
+
+	/* ship only the changes... */
+	INI_DIFF* diff = ini_diff(old_conf, new_conf);
+	for (int i = 0; i < ini_diff_count(diff); i++) {
+		const char* sec_name;
+		const char* key_name;
+		int kind = ini_diff_get(diff, i, &sec_name, &key_name);
+		printf("%s: [%s] %s\n", kind_name(kind), sec_name, key_name);
+	}
+	if (!ini_diff_serialize(diff, "changes.ini")) {
+		printf("libini failed serializing the diff!\n");
+		return 1;
+	}
+
+	/* ...and apply them on the other side */
+	INI_DIFF* received = ini_diff_create();
+	if (!ini_diff_parse(received, "changes.ini")) {
+		printf("libini failed parsing the diff!\n");
+		return 1;
+	}
+	assert(ini_diff_count(received) == ini_diff_count(diff));
+	ini_merge_diff(old_conf, received);
+
+	assert(ini_fingerprint(old_conf) == ini_fingerprint(new_conf));
+	assert(ini_get_key_i(old_conf, "Server", "port") == 9090);
+	assert(!ini_does_key_exist(old_conf, "Server", "debug"));
+	assert(ini_get_key_f(old_conf, "Balancer", "epsilon") == 1e-7f);
+	char retries[INI_STR_MAX_LENGTH];
+	ini_get_key_str(old_conf, "Balancer", "retries", retries, sizeof(retries));
+	assert(strcmp(retries, "10") == 0);
+
+	/* nothing is left between the two */
+	INI_DIFF* left = ini_diff(old_conf, new_conf);
+	assert(ini_diff_count(left) == 0);
+	ini_diff_destroy(left);
+
+	ini_diff_destroy(received);
+	ini_diff_destroy(diff);
+	ini_destroy(new_conf);
+	ini_destroy(old_conf);
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2018 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <libini/ini.h>
+
+/* write the ini only when its content changed since the last write */
+static void save(INI* ini, const char* path, INI_FINGERPRINT* saved)
+{
+	if (ini_fingerprint(ini) == *saved) {
+		printf("%s: unchanged, not written\n", path);
+		return;
+	}
+	if (ini_serialize(ini, path)) {
+		*saved = ini_fingerprint(ini);
+		printf("%s: written\n", path);
+	}
+}
+
+int main()
+{
+	INI* a = ini_create();
+	ini_add_key_i(a, "S", "x", 1);
+	ini_add_key_i(a, "S", "y", 2);
+
+	INI_FINGERPRINT saved = 0;
+	save(a, "fingerprint.ini", &saved);
+	save(a, "fingerprint.ini", &saved);
+
+	/* a file can be checked without parsing it */
+	INI* parsed = ini_create();
+	ini_parse(parsed, "fingerprint.ini");
+	INI_FINGERPRINT file_fp;
+	assert(ini_file_fingerprint("fingerprint.ini", &file_fp));
+	assert(file_fp == ini_source_fingerprint(parsed));
+	assert(ini_fingerprint(parsed) == ini_fingerprint(a));
+
+	/* b drops S.x, c adds it back with another value */
+	INI* b = ini_create();
+	ini_add_key_i(b, "S", "y", 2);
+	INI* c = ini_create();
+	ini_add_key_i(c, "S", "y", 2);
+	ini_add_key_i(c, "S", "x", 3);
+
+	INI_DIFF* ab = ini_diff(a, b);
+	INI_DIFF* bc = ini_diff(b, c);
+	ini_diff_serialize(ab, "ab.ini");
+	ini_diff_serialize(bc, "bc.ini");
+
+	/* both diffs appended into one, removing and re-adding the same key */
+	INI_DIFF* ac = ini_diff_create();
+	ini_diff_parse(ac, "ab.ini");
+	ini_diff_parse(ac, "ab.ini");
+	ini_diff_parse(ac, "bc.ini");
+	ini_merge_diff(a, ac);
+
+	INI_DIFF* check = ini_diff(a, c);
+	assert(ini_diff_count(check) == 0);
+	assert(ini_fingerprint(a) == ini_fingerprint(c));
+	save(a, "fingerprint.ini", &saved);
+
+	ini_diff_destroy(check);
+	ini_diff_destroy(ac);
+	ini_diff_destroy(bc);
+	ini_diff_destroy(ab);
+	ini_destroy(c);
+	ini_destroy(b);
+	ini_destroy(parsed);
+	ini_destroy(a);
+}
\ No newline at end of file
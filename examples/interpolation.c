@@ -0,0 +1,77 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2018 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <libini/ini.h>
+
+static void print_key(INI* ini, const char* sec_name, const char* key_name)
+{
+	char val[INI_STR_MAX_LENGTH];
+	ini_get_key_str(ini, sec_name, key_name, val, INI_STR_MAX_LENGTH);
+	printf("[%s] %s=%s\n", sec_name, key_name, val);
+}
+
+int main()
+{
+	INI* ini = ini_create();
+	ini_set_interpolation(ini, 1);
+
+	ini_add_key_str(ini, "Paths", "root", "/opt/app");
+	ini_add_key_str(ini, "Paths", "logs", "${root}/logs");
+	ini_add_key_i(ini, "Server", "port", 8080);
+	ini_add_key_str(ini, "Server", "url", "http://localhost:${port}${Paths:root}");
+	ini_add_key_str(ini, "Server", "missing", "${nope}");
+
+	/* c1 and c2 reference each other: the references are left as they are */
+	ini_add_key_str(ini, "Cycle", "c1", "${c2}");
+	ini_add_key_str(ini, "Cycle", "c2", "${c1}");
+	ini_add_key_str(ini, "Cycle", "user", "${Paths:root} ${c1}");
+
+	print_key(ini, "Paths", "logs");
+	print_key(ini, "Server", "url");
+	print_key(ini, "Server", "missing");
+	print_key(ini, "Cycle", "c2");
+	print_key(ini, "Cycle", "c1");
+	print_key(ini, "Cycle", "user");
+
+	char val[INI_STR_MAX_LENGTH];
+	ini_get_key_str(ini, "Server", "url", val, INI_STR_MAX_LENGTH);
+	assert(strcmp(val, "http://localhost:8080/opt/app") == 0);
+	ini_get_key_str(ini, "Cycle", "c1", val, INI_STR_MAX_LENGTH);
+	assert(strcmp(val, "${c2}") == 0);
+	ini_get_key_str(ini, "Cycle", "user", val, INI_STR_MAX_LENGTH);
+	assert(strcmp(val, "/opt/app ${c1}") == 0);
+
+	/* a change drops the memoized expansions */
+	ini_remove_key(ini, "Paths", "root");
+	ini_add_key_str(ini, "Paths", "root", "/srv");
+	print_key(ini, "Paths", "logs");
+	ini_get_key_str(ini, "Paths", "logs", val, INI_STR_MAX_LENGTH);
+	assert(strcmp(val, "/srv/logs") == 0);
+
+	ini_destroy(ini);
+}
\ No newline at end of file
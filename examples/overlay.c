@@ -0,0 +1,75 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2018 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libini/ini.h>
+
+int main()
+{
+	INI* defaults = ini_create();
+	ini_add_key_i(defaults, "Window", "width", 800);
+	ini_add_key_i(defaults, "Window", "height", 600);
+	ini_add_key_f(defaults, "Audio", "volume", 0.8f);
+
+	INI* user = ini_create();
+	ini_add_key_i(user, "Window", "width", 1920);
+	ini_add_key_str(user, "Paths", "home", "/home/user");
+	ini_add_key_str(user, "Paths", "config", "${home}/.config");
+	ini_set_interpolation(user, 1);
+
+	/* the last pushed layer wins */
+	INI_OVERLAY* ov = ini_overlay_create();
+	ini_overlay_push(ov, defaults);
+	ini_overlay_push(ov, user);
+
+	assert(ini_overlay_get_key_i(ov, "Window", "width") == 1920);
+	assert(ini_overlay_get_key_i(ov, "Window", "height") == 600);
+	assert(ini_overlay_get_key_f(ov, "Audio", "volume") == 0.8f);
+	printf("window: %dx%d\n", ini_overlay_get_key_i(ov, "Window", "width"),
+		ini_overlay_get_key_i(ov, "Window", "height"));
+
+	/* strings read the same as through the layer itself */
+	char config[INI_STR_MAX_LENGTH];
+	ini_overlay_get_key_str(ov, "Paths", "config", config, sizeof(config));
+	assert(strcmp(config, "/home/user/.config") == 0);
+	printf("config: %s\n", config);
+
+	/* keys no layer has are remembered as such, asking again is cheap */
+	for (int i = 0; i < 1000; i++) {
+		assert(!ini_overlay_does_key_exist(ov, "Window", "fullscreen"));
+	}
+
+	/* changing a layer is seen by the next lookup */
+	ini_add_key_i(user, "Window", "fullscreen", 1);
+	assert(ini_overlay_get_key_i(ov, "Window", "fullscreen") == 1);
+	ini_remove_key(user, "Window", "width");
+	assert(ini_overlay_get_key_i(ov, "Window", "width") == 800);
+
+	ini_overlay_destroy(ov);
+	ini_destroy(user);
+	ini_destroy(defaults);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2018 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libini/ini.h>
+
+typedef struct STATS {
+	int sections;
+	int keys;
+} STATS;
+
+static int on_section(void* user, INI_STRVIEW sec_name)
+{
+	STATS* stats = user;
+	stats->sections++;
+	/* nothing in "Cache" is needed, its keys won't be reported */
+	if (sec_name.len == 5 && memcmp(sec_name.str, "Cache", 5) == 0) {
+		return INI_PARSE_SKIP;
+	}
+	return INI_PARSE_CONTINUE;
+}
+
+static int on_key(void* user, INI_STRVIEW sec_name, INI_STRVIEW key_name, INI_STRVIEW val)
+{
+	STATS* stats = user;
+	stats->keys++;
+	printf("[%.*s] %.*s = %.*s\n", (int)sec_name.len, sec_name.str,
+		(int)key_name.len, key_name.str, (int)val.len, val.str);
+	return INI_PARSE_CONTINUE;
+}
+
+int main()
+{
+	INI* ini = ini_create();
+	ini_add_key_str(ini, "", "name", "demo");
+	ini_add_key_i(ini, "Server", "port", 8080);
+	ini_add_key_i(ini, "Cache", "size", 64);
+	ini_add_key_i(ini, "Cache", "ttl", 30);
+	if (!ini_serialize(ini, "callbacks.ini")) {
+		printf("libini failed serializing the ini!\n");
+		return 1;
+	}
+	ini_destroy(ini);
+
+	/* walk the file without building an INI */
+	INI_PARSE_CALLBACKS cbs;
+	cbs.on_section = on_section;
+	cbs.on_key = on_key;
+	cbs.on_comment = NULL;
+	STATS stats = { 0, 0 };
+	assert(ini_parse_cb("callbacks.ini", &cbs, &stats));
+	assert(stats.sections == 2);
+	assert(stats.keys == 2);
+
+	/* keep only what's needed */
+	const char* names[] = { "", "Server" };
+	INI* part = ini_create();
+	assert(ini_parse_sections(part, "callbacks.ini", names, 2));
+	assert(ini_get_key_i(part, "Server", "port") == 8080);
+	assert(ini_does_key_exist(part, "", "name"));
+	assert(!ini_does_key_exist(part, "Cache", "size"));
+	ini_destroy(part);
+
+	/* an empty list keeps nothing, unlike ini_parse() */
+	INI* none = ini_create();
+	assert(ini_parse_sections(none, "callbacks.ini", NULL, 0));
+	assert(!ini_does_key_exist(none, "Server", "port"));
+	ini_destroy(none);
+
+	INI* all = ini_create();
+	assert(ini_parse(all, "callbacks.ini"));
+	assert(ini_get_key_i(all, "Cache", "ttl") == 30);
+	ini_destroy(all);
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2018 Andrea Vouk.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <libini/ini.h>
+
+/* link with -lrt on older glibc */
+#define CONF_NAME "/libini_example.conf"
+
+int main()
+{
+#ifdef INI_HAVE_SHM
+	INI* ini = ini_create();
+	ini_set_interpolation(ini, 1);
+	ini_add_key_str(ini, "Paths", "root", "/opt/app");
+	ini_add_key_str(ini, "Paths", "logs", "${root}/logs");
+	ini_add_key_i(ini, "Server", "port", 8080);
+
+	/* the publisher, usually the only process parsing the file */
+	if (!ini_shm_publish(ini, CONF_NAME)) {
+		printf("libini failed publishing!\n");
+		return 1;
+	}
+
+	/* a reader, usually in another process */
+	INI_SHM* conf = ini_shm_attach(CONF_NAME);
+	assert(conf);
+	printf("generation %llu: port=%d\n", ini_shm_generation(conf),
+		ini_shm_get_key_i(conf, "Server", "port"));
+
+	/* values are published with their references already expanded */
+	char logs[INI_STR_MAX_LENGTH];
+	ini_shm_get_key_str(conf, "Paths", "logs", logs, INI_STR_MAX_LENGTH);
+	assert(strcmp(logs, "/opt/app/logs") == 0);
+
+	/* nothing new: a single atomic load */
+	assert(!ini_shm_refresh(conf));
+
+	ini_remove_key(ini, "Server", "port");
+	ini_add_key_i(ini, "Server", "port", 9090);
+	ini_shm_publish(ini, CONF_NAME);
+
+	/* readers keep the old generation until they refresh */
+	assert(ini_shm_get_key_i(conf, "Server", "port") == 8080);
+	assert(ini_shm_refresh(conf));
+	printf("generation %llu: port=%d\n", ini_shm_generation(conf),
+		ini_shm_get_key_i(conf, "Server", "port"));
+	assert(ini_shm_get_key_i(conf, "Server", "port") == 9090);
+	assert(ini_shm_fingerprint(conf) == ini_fingerprint(ini));
+
+	ini_shm_detach(conf);
+	ini_shm_unlink(CONF_NAME);
+	ini_destroy(ini);
+#else
+	printf("shared memory publication isn't available on this platform\n");
+#endif
+}
\ No newline at end of file
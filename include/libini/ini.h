@@ -47,6 +47,11 @@
 
 #define INI_STR_MAX_LENGTH	128
 
+/* shared memory publication needs POSIX shm_open() */
+#if defined(__unix__) || defined(__APPLE__)
+#  define INI_HAVE_SHM
+#endif
+
 struct INI;
 typedef struct INI INI;
 
@@ -58,14 +63,198 @@ INIAPI int	ini_does_key_exist(INI* ini, const char* sec_name, const char* key_na
 INIAPI void		ini_add_key_i	(INI* ini, const char* sec_name, const char* key_name, int val);
 INIAPI void		ini_add_key_f	(INI* ini, const char* sec_name, const char* key_name, float val);
 INIAPI void		ini_add_key_str	(INI* ini, const char* sec_name, const char* key_name, const char* val);
+INIAPI void		ini_add_key_iv	(INI* ini, const char* sec_name, const char* key_name, const int* vals, size_t count);
+INIAPI void		ini_add_key_fv	(INI* ini, const char* sec_name, const char* key_name, const float* vals, size_t count);
+
+/* remove the first key with that name, do nothing if it doesn't exist */
+INIAPI void		ini_remove_key	(INI* ini, const char* sec_name, const char* key_name);
 
 INIAPI int		ini_get_key_i	(INI* ini, const char* sec_name, const char* key_name);
 INIAPI float	ini_get_key_f	(INI* ini, const char* sec_name, const char* key_name);
 INIAPI void		ini_get_key_str	(INI* ini, const char* sec_name, const char* key_name, char* out_buff, size_t buff_size);
+/*
+ * Arrays are owned by the ini, NULL and a zero count when the key isn't an array
+ * of that type. They stay valid until the key is changed or removed, or, once
+ * the ini is compacted, until any change to the ini, which moves every array.
+ */
+INIAPI const int*	ini_get_key_iv	(INI* ini, const char* sec_name, const char* key_name, size_t* out_count);
+INIAPI const float*	ini_get_key_fv	(INI* ini, const char* sec_name, const char* key_name, size_t* out_count);
+
+/**
+ * Expand "${Section:key}" and "${key}" (same section) references inside
+ * string values returned by ini_get_key_str(). Expansions are computed on
+ * first access and memoized until the ini is changed again: any change, even
+ * to an unrelated key, drops every memo. Unresolved references, and the ones
+ * leading into a cycle, are left untouched. Values depending on a cycle are
+ * never memoized. Disabled by default.
+ */
+INIAPI void		ini_set_interpolation(INI* ini, int enable);
 
 INIAPI int	ini_serialize	(INI* ini, const char* path);
 INIAPI int	ini_parse		(INI* ini, const char* path);
 
+/**
+ * A read-only stack of INI layers. Lookups are answered by the most recently
+ * pushed layer that has the key, without merging anything. Lookups, found or
+ * not, are cached until one of the layers changes. String values are
+ * interpolated within the layer they come from. The layers are not owned by
+ * the overlay and must outlive it.
+ */
+struct INI_OVERLAY;
+typedef struct INI_OVERLAY INI_OVERLAY;
+
+INIAPI INI_OVERLAY*	ini_overlay_create	(void);
+INIAPI void			ini_overlay_destroy	(INI_OVERLAY* ov);
+INIAPI void			ini_overlay_push	(INI_OVERLAY* ov, INI* layer);
+
+INIAPI int	ini_overlay_does_key_exist(INI_OVERLAY* ov, const char* sec_name, const char* key_name);
+
+INIAPI int		ini_overlay_get_key_i	(INI_OVERLAY* ov, const char* sec_name, const char* key_name);
+INIAPI float	ini_overlay_get_key_f	(INI_OVERLAY* ov, const char* sec_name, const char* key_name);
+INIAPI void		ini_overlay_get_key_str	(INI_OVERLAY* ov, const char* sec_name, const char* key_name, char* out_buff, size_t buff_size);
+
+/**
+ * The differences between two INI, computed in linear time. Only the
+ * sections and keys visible through lookups are compared.
+ */
+struct INI_DIFF;
+typedef struct INI_DIFF INI_DIFF;
+
+/* kinds of diff entries */
+#define INI_DIFF_ADDED		'+'
+#define INI_DIFF_REMOVED	'-'
+#define INI_DIFF_CHANGED	'~'
+
+/* ini_merge() policies */
+#define INI_MERGE_OVERWRITE	0	/* src values replace the existing ones */
+#define INI_MERGE_KEEP		1	/* existing values are kept, only new keys are added */
+#define INI_MERGE_MIRROR	2	/* like overwrite, plus keys missing from src are removed */
+
+/* the changes needed to turn a into b */
+INIAPI INI_DIFF*	ini_diff			(INI* a, INI* b);
+/* an empty diff, to be filled by ini_diff_parse() */
+INIAPI INI_DIFF*	ini_diff_create		(void);
+INIAPI void			ini_diff_destroy	(INI_DIFF* diff);
+
+INIAPI int	ini_diff_count	(INI_DIFF* diff);
+/* returns the entry kind, the names are owned by the diff */
+INIAPI int	ini_diff_get	(INI_DIFF* diff, int idx, const char** sec_name, const char** key_name);
+
+/*
+ * A regular ini file whose section names are prefixed by the entry kind, e.g.
+ * "[+Paths]" holds the keys added to "Paths". String values are quoted so they
+ * keep their type, e.g. name="10". Parsing appends to the diff and fails on
+ * section names longer than INI_STR_MAX_LENGTH - 1.
+ */
+INIAPI int	ini_diff_serialize	(INI_DIFF* diff, const char* path);
+INIAPI int	ini_diff_parse		(INI_DIFF* diff, const char* path);
+
+INIAPI int	ini_merge		(INI* dst, INI* src, int policy);
+INIAPI int	ini_merge_diff	(INI* dst, INI_DIFF* diff);
+
+/* bytes used by each part of an INI versus the bytes actually reserved for it */
+typedef struct INI_MEMORY_USAGE {
+	size_t sections_used;
+	size_t sections_reserved;
+	size_t keys_used;
+	size_t keys_reserved;
+	size_t arrays_used;
+	size_t arrays_reserved;
+	size_t indices_used;	/* section and key pointer tables */
+	size_t indices_reserved;
+	size_t memos_used;		/* interpolated values */
+	size_t memos_reserved;
+	size_t total_used;
+	size_t total_reserved;
+} INI_MEMORY_USAGE;
+
+/**
+ * Relocate the whole INI into a single allocation, laid out in iteration order.
+ * Records are cut right after their value and followed by their name, arrays
+ * are packed. Interpolated values stay in their own allocations. The next
+ * change (add, remove, parse or merge) moves everything back to separate
+ * allocations, invalidating the arrays returned so far.
+ */
+INIAPI void	ini_compact			(INI* ini);
+INIAPI void	ini_memory_usage	(INI* ini, INI_MEMORY_USAGE* usage);
+
+typedef unsigned long long INI_FINGERPRINT;
+
+/**
+ * Fingerprint of the logical content: every (section, key, value) entry,
+ * regardless of the order. It's kept up to date by every change so it costs
+ * nothing to query, and is stable across processes on the same platform.
+ */
+INIAPI INI_FINGERPRINT	ini_fingerprint			(INI* ini);
+/* fingerprint of the raw bytes of the last file parsed into ini, 0 if none */
+INIAPI INI_FINGERPRINT	ini_source_fingerprint	(INI* ini);
+/* hash a file's raw bytes, to be compared with ini_source_fingerprint() before parsing again */
+INIAPI int				ini_file_fingerprint	(const char* path, INI_FINGERPRINT* out_fp);
+
+#ifdef INI_HAVE_SHM
+
+/**
+ * A read-only, pointer-free copy of an INI living in POSIX shared memory, so
+ * that a single process parses and the others read. The objects are created
+ * with mode 0600: only processes of the publishing user can attach, and
+ * objects owned by another user are refused. Images are bounds-checked once
+ * when mapped. Each ini_shm_publish() makes a new generation. Readers switch to it with
+ * ini_shm_refresh(), which costs a single atomic load when nothing changed.
+ * Only one process should publish under a given name.
+ */
+struct INI_SHM;
+typedef struct INI_SHM INI_SHM;
+
+/* name follows shm_open() rules, e.g. "/myapp.conf" */
+INIAPI int		ini_shm_publish	(INI* ini, const char* name);
+INIAPI int		ini_shm_unlink	(const char* name);
+
+INIAPI INI_SHM*	ini_shm_attach	(const char* name);
+INIAPI void		ini_shm_detach	(INI_SHM* shm);
+/* returns 1 when a newer generation is now in use, which invalidates the returned arrays */
+INIAPI int		ini_shm_refresh	(INI_SHM* shm);
+
+INIAPI unsigned long long	ini_shm_generation	(INI_SHM* shm);
+INIAPI INI_FINGERPRINT		ini_shm_fingerprint	(INI_SHM* shm);
+
+INIAPI int	ini_shm_does_key_exist(INI_SHM* shm, const char* sec_name, const char* key_name);
+
+INIAPI int			ini_shm_get_key_i	(INI_SHM* shm, const char* sec_name, const char* key_name);
+INIAPI float		ini_shm_get_key_f	(INI_SHM* shm, const char* sec_name, const char* key_name);
+INIAPI void			ini_shm_get_key_str	(INI_SHM* shm, const char* sec_name, const char* key_name, char* out_buff, size_t buff_size);
+INIAPI const int*	ini_shm_get_key_iv	(INI_SHM* shm, const char* sec_name, const char* key_name, size_t* out_count);
+INIAPI const float*	ini_shm_get_key_fv	(INI_SHM* shm, const char* sec_name, const char* key_name, size_t* out_count);
+
+#endif /* INI_HAVE_SHM */
+
+/**
+ * A non-owning view inside the parser's buffer. It's not null terminated and
+ * only valid for the duration of the callback it has been passed to.
+ */
+typedef struct INI_STRVIEW {
+	const char* str;
+	size_t len;
+} INI_STRVIEW;
+
+/* values returned by the parsing callbacks */
+#define INI_PARSE_STOP		0
+#define INI_PARSE_CONTINUE	1
+#define INI_PARSE_SKIP		2	/* on_section only: skip the section's keys */
+
+typedef struct INI_PARSE_CALLBACKS {
+	int (*on_section)	(void* user, INI_STRVIEW sec_name);
+	int (*on_key)		(void* user, INI_STRVIEW sec_name, INI_STRVIEW key_name, INI_STRVIEW val);
+	int (*on_comment)	(void* user, INI_STRVIEW text);
+} INI_PARSE_CALLBACKS;
+
+/* parse without building anything, NULL callbacks are ignored */
+INIAPI int	ini_parse_cb		(const char* path, const INI_PARSE_CALLBACKS* cbs, void* user);
+/*
+ * Like ini_parse() but only the sections in names are kept ("" is the global
+ * one). No names, NULL included, means no section is kept.
+ */
+INIAPI int	ini_parse_sections	(INI* ini, const char* path, const char** names, size_t names_count);
+
 /* C11 support required */
 #if !defined(__cplusplus) && (__STDC_VERSION__ >= 201112L)
 
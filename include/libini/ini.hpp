@@ -33,6 +33,18 @@
 
 #include <string>
 #include <optional>
+#include <vector>
+#include <utility>
+
+/* the array values are exposed as std::span from C++20 onwards */
+#if defined(__has_include)
+#  if __has_include(<version>)
+#    include <version>
+#  endif
+#endif
+#if defined(__cpp_lib_span)
+#  include <span>
+#endif
 
 namespace libini
 {
@@ -46,6 +58,9 @@ extern "C"
 
 } // c_api
 
+class overlay;
+class diff;
+
 /**
  * a representation of a .ini file.
  *
@@ -125,6 +140,44 @@ public:
 		c_api::ini_add_key_str(m_ini, sec_name.c_str(), key_name.c_str(), val.c_str());
 	}
 
+#if defined(__cpp_lib_span)
+	/**
+	 * Add a unique key with an array of ints as value.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 * @param val       The key's values, copied into the ini
+	 */
+	inline void set(const std::string& sec_name, const std::string& key_name, std::span<const int> val) const noexcept
+	{
+		c_api::ini_add_key_iv(m_ini, sec_name.c_str(), key_name.c_str(), val.data(), val.size());
+	}
+
+	/**
+	 * Add a unique key with an array of floats as value.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 * @param val       The key's values, copied into the ini
+	 */
+	inline void set(const std::string& sec_name, const std::string& key_name, std::span<const float> val) const noexcept
+	{
+		c_api::ini_add_key_fv(m_ini, sec_name.c_str(), key_name.c_str(), val.data(), val.size());
+	}
+#endif // __cpp_lib_span
+
+	/**
+	 * Enable or disable the expansion of "${Section:key}" and "${key}"
+	 * references in string values. Expansions are memoized until the
+	 * next change.
+	 *
+	 * @param enable  true to expand references in get<std::string>()
+	 */
+	inline void set_interpolation(bool enable) const noexcept
+	{
+		c_api::ini_set_interpolation(m_ini, static_cast<int>(enable));
+	}
+
 	/**
 	 * Get the key's value of type T.
 	 *
@@ -134,15 +187,19 @@ public:
 	 * @param sec_name  The key's section
 	 * @param key_name  The key's name
 	 *
-	 * @tparam T  The key type. Either <code>int</code>, <code>float</code>
-	 *            or <code>std::string</code>
+	 * @tparam T  The key type. Either <code>int</code>, <code>float</code>,
+	 *            <code>std::string</code> or, from C++20, <code>std::span<const int></code>
+	 *            and <code>std::span<const float></code>. Spans point inside
+	 *            the ini and are empty when the key isn't such an array. They
+	 *            are invalidated by changes to the key or, after compact(), by
+	 *            any change to the ini.
 	 *
 	 * @return The key's value
 	 */
 	template<class T>
 	inline T get(const std::string& sec_name, const std::string& key_name) const noexcept
 	{
-		static_assert(0, "T in get<T> can be only one of the following: 'int', 'float' or 'std::string'");
+		static_assert(0, "T in get<T> can be only one of the following: 'int', 'float', 'std::string', 'std::span<const int>' or 'std::span<const float>'");
 	}
 
 	template<>
@@ -165,6 +222,24 @@ public:
 		return std::string(cstr);
 	}
 
+#if defined(__cpp_lib_span)
+	template<>
+	inline std::span<const int> get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		size_t count;
+		const int* data = c_api::ini_get_key_iv(m_ini, sec_name.c_str(), key_name.c_str(), &count);
+		return std::span<const int>(data, count);
+	}
+
+	template<>
+	inline std::span<const float> get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		size_t count;
+		const float* data = c_api::ini_get_key_fv(m_ini, sec_name.c_str(), key_name.c_str(), &count);
+		return std::span<const float>(data, count);
+	}
+#endif // __cpp_lib_span
+
 	/**
 	 * Get the key's value of type T. If the key doesn't exist return an
 	 * empty value.
@@ -172,8 +247,9 @@ public:
 	 * @param sec_name  The key's section
 	 * @param key_name  The key's name
 	 *
-	 * @tparam T  The key type. Either <code>int</code>, <code>float</code>
-	 *            or <code>std::string</code>
+	 * @tparam T  The key type. Either <code>int</code>, <code>float</code>,
+	 *            <code>std::string</code> or, from C++20, <code>std::span<const int></code>
+	 *            and <code>std::span<const float></code>
 	 *
 	 * @return An empty <code>std::optional<T></code> when the key doesn't
 	 *         exist
@@ -181,7 +257,7 @@ public:
 	template<class T>
 	inline std::optional<T> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
 	{
-		static_assert(0, "T in get_opt<T> can be only one of the following: 'int', 'float' or 'std::string'");
+		static_assert(0, "T in get_opt<T> can be only one of the following: 'int', 'float', 'std::string', 'std::span<const int>' or 'std::span<const float>'");
 	}
 
 	template<>
@@ -213,6 +289,26 @@ public:
 		return std::optional<std::string>();
 	}
 
+#if defined(__cpp_lib_span)
+	template<>
+	inline std::optional<std::span<const int>> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		if (exist(sec_name, key_name)) {
+			return get<std::span<const int>>(sec_name, key_name);
+		}
+		return std::optional<std::span<const int>>();
+	}
+
+	template<>
+	inline std::optional<std::span<const float>> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		if (exist(sec_name, key_name)) {
+			return get<std::span<const float>>(sec_name, key_name);
+		}
+		return std::optional<std::span<const float>>();
+	}
+#endif // __cpp_lib_span
+
 	/**
 	 * Check whether or not the key exists.
 	 *
@@ -250,10 +346,577 @@ public:
 		return static_cast<bool>(c_api::ini_parse(m_ini, path.c_str()));
 	}
 
+	/**
+	 * Parse an ini file keeping only the given sections. The body of every
+	 * other section is skipped without being stored.
+	 *
+	 * @param path       The file's path
+	 * @param sec_names  The sections to keep, use "" for the global one. An
+	 *                   empty list keeps no section
+	 *
+	 * @return true when the parsing process succeeded
+	 */
+	inline bool parse_sections(const std::string& path, const std::vector<std::string>& sec_names) const
+	{
+		std::vector<const char*> names;
+		names.reserve(sec_names.size());
+		for (const auto& name : sec_names) {
+			names.push_back(name.c_str());
+		}
+		return static_cast<bool>(c_api::ini_parse_sections(m_ini, path.c_str(), names.data(), names.size()));
+	}
+
+	/**
+	 * Remove a key.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 */
+	inline void remove(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		c_api::ini_remove_key(m_ini, sec_name.c_str(), key_name.c_str());
+	}
+
+	/**
+	 * Merge another ini into this one in place.
+	 *
+	 * @param src     The ini to merge
+	 * @param policy  One of INI_MERGE_OVERWRITE, INI_MERGE_KEEP or
+	 *                INI_MERGE_MIRROR
+	 *
+	 * @return true when the merge succeeded
+	 */
+	inline bool merge(const ini& src, int policy = INI_MERGE_OVERWRITE) const noexcept
+	{
+		return static_cast<bool>(c_api::ini_merge(m_ini, src.m_ini, policy));
+	}
+
+	/**
+	 * Apply a diff in place.
+	 *
+	 * @param changes  The diff to apply
+	 *
+	 * @return true when the merge succeeded
+	 */
+	inline bool merge(const diff& changes) const noexcept;
+
+	/**
+	 * Pack the whole ini into a single allocation. Any later change
+	 * unpacks it again and invalidates the spans returned so far.
+	 */
+	inline void compact() const noexcept
+	{
+		c_api::ini_compact(m_ini);
+	}
+
+	/**
+	 * @return The bytes used and reserved by each part of the ini
+	 */
+	inline c_api::INI_MEMORY_USAGE memory_usage() const noexcept
+	{
+		c_api::INI_MEMORY_USAGE usage;
+		c_api::ini_memory_usage(m_ini, &usage);
+		return usage;
+	}
+
+	/**
+	 * @return The fingerprint of the ini's content, regardless of the
+	 *         order of sections and keys
+	 */
+	inline c_api::INI_FINGERPRINT fingerprint() const noexcept
+	{
+		return c_api::ini_fingerprint(m_ini);
+	}
+
+	/**
+	 * @return The fingerprint of the last parsed file's raw bytes, 0 if
+	 *         nothing was parsed
+	 */
+	inline c_api::INI_FINGERPRINT source_fingerprint() const noexcept
+	{
+		return c_api::ini_source_fingerprint(m_ini);
+	}
+
+	/**
+	 * Hash a file's raw bytes without parsing it. Compare it with
+	 * source_fingerprint() to skip parsing an unchanged file.
+	 *
+	 * @param path  The file's path
+	 *
+	 * @return An empty <code>std::optional</code> when the file can't be read
+	 */
+	static inline std::optional<c_api::INI_FINGERPRINT> file_fingerprint(const std::string& path) noexcept
+	{
+		c_api::INI_FINGERPRINT fp;
+		if (c_api::ini_file_fingerprint(path.c_str(), &fp)) {
+			return fp;
+		}
+		return std::optional<c_api::INI_FINGERPRINT>();
+	}
+
+#ifdef INI_HAVE_SHM
+	/**
+	 * Publish a read-only copy to shared memory for shm_reader instances,
+	 * also in other processes. Publishing again replaces it atomically.
+	 *
+	 * @param name  The shared memory object's name, e.g. "/myapp.conf"
+	 *
+	 * @return true when the publication succeeded
+	 */
+	inline bool publish(const std::string& name) const noexcept
+	{
+		return static_cast<bool>(c_api::ini_shm_publish(m_ini, name.c_str()));
+	}
+#endif // INI_HAVE_SHM
+
 private:
+	friend class overlay;
+	friend class diff;
+
 	c_api::INI* m_ini;
 };
 
+/**
+ * A read-only stack of ini instances. Lookups are answered by the most
+ * recently pushed layer which has the key.
+ *
+ * @warning The pushed layers are not owned by the overlay and must outlive it.
+ */
+class overlay
+{
+public:
+	overlay()
+	{
+		m_ov = c_api::ini_overlay_create();
+	}
+
+	~overlay()
+	{
+		if (m_ov) {
+			c_api::ini_overlay_destroy(m_ov);
+		}
+	}
+
+	overlay(const overlay& other) = delete;
+	overlay& operator=(const overlay& other) = delete;
+
+	overlay(overlay&& other) noexcept
+	{
+		this->m_ov = other.m_ov;
+		other.m_ov = nullptr;
+	}
+
+	overlay& operator=(overlay&& other) noexcept
+	{
+		std::swap(this->m_ov, other.m_ov);
+		return *this;
+	}
+
+	/**
+	 * Check whether or not the class initialization succeeded and it's
+	 * ready to be used.
+	 *
+	 * @return true if everything is ok
+	 */
+	constexpr inline bool is_ready() const noexcept
+	{
+		return m_ov != nullptr;
+	}
+
+	/**
+	 * Push a layer on top of the others.
+	 *
+	 * @param layer  The ini with the highest precedence so far
+	 */
+	inline void push(const ini& layer) const noexcept
+	{
+		c_api::ini_overlay_push(m_ov, layer.m_ini);
+	}
+
+	/**
+	 * Get the key's value of type T from the topmost layer which has it.
+	 *
+	 * @warning Make sure the key does exist before calling this function.
+	 *          Use get_opt() if you can't be certain of it.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 *
+	 * @tparam T  The key type. Either <code>int</code>, <code>float</code>
+	 *            or <code>std::string</code>
+	 *
+	 * @return The key's value
+	 */
+	template<class T>
+	inline T get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		static_assert(0, "T in get<T> can be only one of the following: 'int', 'float' or 'std::string'");
+	}
+
+	template<>
+	inline int get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		return c_api::ini_overlay_get_key_i(m_ov, sec_name.c_str(), key_name.c_str());
+	}
+
+	template<>
+	inline float get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		return c_api::ini_overlay_get_key_f(m_ov, sec_name.c_str(), key_name.c_str());
+	}
+
+	template<>
+	inline std::string get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		char cstr[INI_STR_MAX_LENGTH];
+		c_api::ini_overlay_get_key_str(m_ov, sec_name.c_str(), key_name.c_str(), cstr, INI_STR_MAX_LENGTH);
+		return std::string(cstr);
+	}
+
+	/**
+	 * Get the key's value of type T. If no layer has the key return an
+	 * empty value.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 *
+	 * @tparam T  The key type. Either <code>int</code>, <code>float</code>
+	 *            or <code>std::string</code>
+	 *
+	 * @return An empty <code>std::optional<T></code> when the key doesn't
+	 *         exist
+	 */
+	template<class T>
+	inline std::optional<T> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		static_assert(0, "T in get_opt<T> can be only one of the following: 'int', 'float' or 'std::string'");
+	}
+
+	template<>
+	inline std::optional<int> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		if (exist(sec_name, key_name)) {
+			return get<int>(sec_name, key_name);
+		}
+		return std::optional<int>();
+	}
+
+	template<>
+	inline std::optional<float> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		if (exist(sec_name, key_name)) {
+			return get<float>(sec_name, key_name);
+		}
+		return std::optional<float>();
+	}
+
+	template<>
+	inline std::optional<std::string> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		if (exist(sec_name, key_name)) {
+			return get<std::string>(sec_name, key_name);
+		}
+		return std::optional<std::string>();
+	}
+
+	/**
+	 * Check whether or not any layer has the key.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 *
+	 * @return true if the key exists
+	 */
+	inline bool exist(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		return static_cast<bool>(c_api::ini_overlay_does_key_exist(m_ov, sec_name.c_str(), key_name.c_str()));
+	}
+
+private:
+	c_api::INI_OVERLAY* m_ov;
+};
+
+/**
+ * The added, removed and changed keys between two ini.
+ */
+class diff
+{
+public:
+	struct entry
+	{
+		int kind;	// INI_DIFF_ADDED, INI_DIFF_REMOVED or INI_DIFF_CHANGED
+		std::string sec_name;
+		std::string key_name;
+	};
+
+	/**
+	 * An empty diff, meant to be filled by parse().
+	 */
+	diff()
+	{
+		m_diff = c_api::ini_diff_create();
+	}
+
+	/**
+	 * The changes needed to turn a into b.
+	 */
+	diff(const ini& a, const ini& b)
+	{
+		m_diff = c_api::ini_diff(a.m_ini, b.m_ini);
+	}
+
+	~diff()
+	{
+		if (m_diff) {
+			c_api::ini_diff_destroy(m_diff);
+		}
+	}
+
+	diff(const diff& other) = delete;
+	diff& operator=(const diff& other) = delete;
+
+	diff(diff&& other) noexcept
+	{
+		this->m_diff = other.m_diff;
+		other.m_diff = nullptr;
+	}
+
+	diff& operator=(diff&& other) noexcept
+	{
+		std::swap(this->m_diff, other.m_diff);
+		return *this;
+	}
+
+	/**
+	 * @return The number of entries
+	 */
+	inline int count() const noexcept
+	{
+		return c_api::ini_diff_count(m_diff);
+	}
+
+	/**
+	 * @param idx  The entry's index, less than count()
+	 *
+	 * @return The entry at idx
+	 */
+	inline entry get(int idx) const
+	{
+		const char* sec_name;
+		const char* key_name;
+		int kind = c_api::ini_diff_get(m_diff, idx, &sec_name, &key_name);
+		return entry{ kind, sec_name, key_name };
+	}
+
+	/**
+	 * Serialize to an ini file which can be shipped instead of the whole ini.
+	 *
+	 * @param path  The file's path
+	 *
+	 * @return true when the serialization process succeeded
+	 */
+	inline bool serialize(const std::string& path) const noexcept
+	{
+		return static_cast<bool>(c_api::ini_diff_serialize(m_diff, path.c_str()));
+	}
+
+	/**
+	 * Parse a diff previously written by serialize().
+	 *
+	 * @param path  The file's path
+	 *
+	 * @return true when the parsing process succeeded
+	 */
+	inline bool parse(const std::string& path) const noexcept
+	{
+		return static_cast<bool>(c_api::ini_diff_parse(m_diff, path.c_str()));
+	}
+
+private:
+	friend class ini;
+
+	c_api::INI_DIFF* m_diff;
+};
+
+inline bool ini::merge(const diff& changes) const noexcept
+{
+	return static_cast<bool>(c_api::ini_merge_diff(m_ini, changes.m_diff));
+}
+
+#ifdef INI_HAVE_SHM
+
+/**
+ * A read-only view of an ini published to shared memory with ini::publish(),
+ * possibly by another process.
+ *
+ * @warning Spans returned by get() are invalidated by a refresh() which
+ *          switches generation.
+ */
+class shm_reader
+{
+public:
+	explicit shm_reader(const std::string& name)
+	{
+		m_shm = c_api::ini_shm_attach(name.c_str());
+	}
+
+	~shm_reader()
+	{
+		if (m_shm) {
+			c_api::ini_shm_detach(m_shm);
+		}
+	}
+
+	shm_reader(const shm_reader& other) = delete;
+	shm_reader& operator=(const shm_reader& other) = delete;
+
+	shm_reader(shm_reader&& other) noexcept
+	{
+		this->m_shm = other.m_shm;
+		other.m_shm = nullptr;
+	}
+
+	shm_reader& operator=(shm_reader&& other) noexcept
+	{
+		std::swap(this->m_shm, other.m_shm);
+		return *this;
+	}
+
+	/**
+	 * Check whether or not something was published under the name.
+	 *
+	 * @return true if everything is ok
+	 */
+	constexpr inline bool is_ready() const noexcept
+	{
+		return m_shm != nullptr;
+	}
+
+	/**
+	 * Switch to the latest published generation, if any.
+	 *
+	 * @return true if the generation changed
+	 */
+	inline bool refresh() const noexcept
+	{
+		return static_cast<bool>(c_api::ini_shm_refresh(m_shm));
+	}
+
+	/**
+	 * @return The generation in use, increased by each publish
+	 */
+	inline unsigned long long generation() const noexcept
+	{
+		return c_api::ini_shm_generation(m_shm);
+	}
+
+	/**
+	 * @return The published ini's fingerprint()
+	 */
+	inline c_api::INI_FINGERPRINT fingerprint() const noexcept
+	{
+		return c_api::ini_shm_fingerprint(m_shm);
+	}
+
+	/**
+	 * Get the key's value of type T.
+	 *
+	 * @warning Make sure the key does exist before calling this function.
+	 *          Use get_opt() if you can't be certain of it.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 *
+	 * @tparam T  The key type. Either <code>int</code>, <code>float</code>,
+	 *            <code>std::string</code> or, from C++20, <code>std::span<const int></code>
+	 *            and <code>std::span<const float></code>
+	 *
+	 * @return The key's value
+	 */
+	template<class T>
+	inline T get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		static_assert(0, "T in get<T> can be only one of the following: 'int', 'float', 'std::string', 'std::span<const int>' or 'std::span<const float>'");
+	}
+
+	template<>
+	inline int get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		return c_api::ini_shm_get_key_i(m_shm, sec_name.c_str(), key_name.c_str());
+	}
+
+	template<>
+	inline float get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		return c_api::ini_shm_get_key_f(m_shm, sec_name.c_str(), key_name.c_str());
+	}
+
+	template<>
+	inline std::string get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		char cstr[INI_STR_MAX_LENGTH];
+		c_api::ini_shm_get_key_str(m_shm, sec_name.c_str(), key_name.c_str(), cstr, INI_STR_MAX_LENGTH);
+		return std::string(cstr);
+	}
+
+#if defined(__cpp_lib_span)
+	template<>
+	inline std::span<const int> get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		size_t count;
+		const int* data = c_api::ini_shm_get_key_iv(m_shm, sec_name.c_str(), key_name.c_str(), &count);
+		return std::span<const int>(data, count);
+	}
+
+	template<>
+	inline std::span<const float> get(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		size_t count;
+		const float* data = c_api::ini_shm_get_key_fv(m_shm, sec_name.c_str(), key_name.c_str(), &count);
+		return std::span<const float>(data, count);
+	}
+#endif // __cpp_lib_span
+
+	/**
+	 * Get the key's value of type T. If the key doesn't exist return an
+	 * empty value.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 *
+	 * @tparam T  The key type, same as get()
+	 *
+	 * @return An empty <code>std::optional<T></code> when the key doesn't
+	 *         exist
+	 */
+	template<class T>
+	inline std::optional<T> get_opt(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		if (exist(sec_name, key_name)) {
+			return get<T>(sec_name, key_name);
+		}
+		return std::optional<T>();
+	}
+
+	/**
+	 * Check whether or not the key exists.
+	 *
+	 * @param sec_name  The key's section
+	 * @param key_name  The key's name
+	 *
+	 * @return true if the key exists
+	 */
+	inline bool exist(const std::string& sec_name, const std::string& key_name) const noexcept
+	{
+		return static_cast<bool>(c_api::ini_shm_does_key_exist(m_shm, sec_name.c_str(), key_name.c_str()));
+	}
+
+private:
+	c_api::INI_SHM* m_shm;
+};
+
+#endif // INI_HAVE_SHM
+
 } // libini
 
 #endif // INI_HPP
\ No newline at end of file
@@ -22,75 +22,367 @@
  * THE SOFTWARE.
  */
 
+#if defined(__unix__) || defined(__APPLE__)
+#  define _POSIX_C_SOURCE 200809L	/* shm_open(), ftruncate() */
+#endif
+
 #include "libini/ini.h"
 
-#include <stdio.h>	/* fprintf() */
-#include <stdlib.h>	/* malloc(), free() */
-#include <string.h>	/* strcmp(), strcpy(), strcpy_s() */
-#include <ctype.h>	/* isspace(), iscntrl(), isalpha() */
+#include <stdio.h>	/* fprintf(), snprintf() */
+#include <stdlib.h>	/* malloc(), free(), strtof() */
+#include <string.h>	/* strcmp(), strcpy_s(), memchr() */
+#include <ctype.h>	/* isspace(), iscntrl(), isalpha(), tolower() */
+#include <assert.h>	/* assert() */
+#include <stdint.h>	/* uint64_t */
+#include <stddef.h>	/* offsetof() */
+#include <math.h>	/* NAN, INFINITY */
+
+#ifdef INI_HAVE_SHM
+#  include <fcntl.h>		/* O_* */
+#  include <sys/mman.h>		/* shm_open(), mmap() */
+#  include <sys/stat.h>		/* fstat() */
+#  include <unistd.h>		/* ftruncate(), close() */
+#  include <stdatomic.h>	/* atomic_load_explicit(), atomic_store_explicit() */
+#endif
 
 #define KVAL_TYPE_UNDEFINED	0
 #define KVAL_TYPE_INT		1
 #define KVAL_TYPE_FLOAT		2
 #define KVAL_TYPE_STR		3
+#define KVAL_TYPE_INT_ARRAY	4
+#define KVAL_TYPE_FLOAT_ARRAY	5
+#define KVAL_TYPE_REMOVED	-1	/* waiting to be swept away */
 
+/*
+ * The value union and the section name are kept last: once compacted, records
+ * are cut right after the bytes they actually use.
+ */
 typedef struct INI_KEY {
-	char key_name[INI_STR_MAX_LENGTH];
+	int t_val;
+	/* interpolation */
+	int has_refs;
+	int resolving;
+	unsigned xval_gen;
+	char* xval;
+	char* key_name;	/* stored right after the record, see key_create() */
 	union {
 		int ival;
 		float fval;
 		char sval[INI_STR_MAX_LENGTH];
+		struct {
+			int* data;
+			size_t count;
+		} iarr;
+		struct {
+			float* data;
+			size_t count;
+		} farr;
 	};
-	int t_val;
 } INI_KEY;
 
 typedef struct INI_SECTION {
-	char sec_name[INI_STR_MAX_LENGTH];
 	INI_KEY** keys;
 	int keys_count;
+	char sec_name[INI_STR_MAX_LENGTH];
 } INI_SECTION;
 
 struct INI {
 	INI_SECTION** secs;
 	int secs_count;
+	unsigned generation;	/* bumped on every change */
+	int interpolate;
+	char* block;	/* set when compacted, holds every record */
+	size_t block_size;
+	uint64_t fingerprint;
+	uint64_t source_fingerprint;	/* raw bytes of the last parsed file */
 };
 
+#define foreach_section(ini) \
+	for (int isec = 0; isec < ini->secs_count; isec++) \
+		for (INI_SECTION* sec = ini->secs[isec]; sec; sec = NULL)
+
+#define foreach_key(sec) \
+	for (int ikey = 0; ikey < sec->keys_count; ikey++) \
+		for (INI_KEY* key = sec->keys[ikey]; key; key = NULL)
+
 /* handle here what happens when memory allocation fails */
 #define alloc_check(x, msg) if (!x) { assert(0 && msg); exit(EXIT_FAILURE); }
 
+#ifndef _MSC_VER
+/*
+ * Annex K is optional and neither glibc nor the Apple libc ship it. Like
+ * strcpy_s() with a handler which doesn't abort: an oversized src leaves dest
+ * empty.
+ */
+static int ini_strcpy_s(char* dest, size_t dest_size, const char* src)
+{
+	size_t len = strlen(src);
+	if (len >= dest_size) {
+		if (dest_size > 0) dest[0] = '\0';
+		return 1;
+	}
+	memcpy(dest, src, len + 1);
+	return 0;
+}
+#define strcpy_s ini_strcpy_s
+#endif
+
+/*------------------------------------------------------------------------------
+	HASHING
+------------------------------------------------------------------------------*/
+
+#define HASH_SEED	14695981039346656037ULL
+#define HASH_PRIME	1099511628211ULL
+#define HASH_MULT	0x9e3779b97f4a7c15ULL
+
+static uint64_t hash_str(uint64_t h, const char* str)
+{
+	for (; *str; str++) {
+		h = (h ^ (unsigned char)*str) * HASH_PRIME;
+	}
+	return h;
+}
+
+static uint64_t hash_entry(const char* sec_name, const char* key_name)
+{
+	uint64_t h = hash_str(HASH_SEED, sec_name);
+	if (key_name) {
+		h = (h ^ '\n') * HASH_PRIME;
+		h = hash_str(h, key_name);
+	}
+	return h;
+}
+
+/* splitmix64 finalizer */
+static uint64_t hash_mix(uint64_t h)
+{
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	return h ^ (h >> 31);
+}
+
+static uint64_t hash_word(uint64_t h, const unsigned char* p)
+{
+	uint64_t w;
+	memcpy(&w, p, sizeof(w));
+	h = (h ^ w) * HASH_MULT;
+	return h ^ (h >> 32);
+}
+
+/* hashes 8 bytes at a time, the result doesn't depend on how data is split */
+typedef struct HASH_STREAM {
+	uint64_t h;
+	uint64_t len;
+	unsigned char tail[8];
+	size_t tail_len;
+} HASH_STREAM;
+
+static void hash_stream_init(HASH_STREAM* hs)
+{
+	hs->h = HASH_SEED;
+	hs->len = 0;
+	hs->tail_len = 0;
+}
+
+static void hash_stream_update(HASH_STREAM* hs, const void* data, size_t len)
+{
+	const unsigned char* p = data;
+	hs->len += len;
+	if (hs->tail_len > 0) {
+		while (hs->tail_len < 8 && len > 0) {
+			hs->tail[hs->tail_len++] = *p++;
+			len--;
+		}
+		if (hs->tail_len < 8) return;
+		hs->h = hash_word(hs->h, hs->tail);
+		hs->tail_len = 0;
+	}
+	for (; len >= 8; p += 8, len -= 8) {
+		hs->h = hash_word(hs->h, p);
+	}
+	memcpy(hs->tail, p, len);
+	hs->tail_len = len;
+}
+
+static uint64_t hash_stream_final(HASH_STREAM* hs)
+{
+	uint64_t h = hs->h;
+	for (size_t i = 0; i < hs->tail_len; i++) {
+		h = (h ^ hs->tail[i]) * HASH_PRIME;
+	}
+	return hash_mix(h ^ hs->len);
+}
+
+static uint64_t hash_block(const void* data, size_t len)
+{
+	HASH_STREAM hs;
+	hash_stream_init(&hs);
+	hash_stream_update(&hs, data, len);
+	return hash_stream_final(&hs);
+}
+
+/*
+ * The fingerprint of an INI is the sum of its keys' fingerprints, so it can be
+ * updated in constant time on every change and doesn't depend on the order.
+ */
+static uint64_t key_fingerprint(const char* sec_name, const INI_KEY* key)
+{
+	uint64_t h = hash_entry(sec_name, key->key_name);
+	h = (h ^ (uint64_t)(unsigned)key->t_val) * HASH_PRIME;
+	switch (key->t_val) {
+		case KVAL_TYPE_INT:
+			return hash_mix(h ^ hash_block(&key->ival, sizeof(key->ival)));
+		case KVAL_TYPE_FLOAT:
+			return hash_mix(h ^ hash_block(&key->fval, sizeof(key->fval)));
+		case KVAL_TYPE_STR:
+			return hash_mix(h ^ hash_block(key->sval, strlen(key->sval)));
+		case KVAL_TYPE_INT_ARRAY:
+			return hash_mix(h ^ hash_block(key->iarr.data, key->iarr.count * sizeof(int)));
+		case KVAL_TYPE_FLOAT_ARRAY:
+			return hash_mix(h ^ hash_block(key->farr.data, key->farr.count * sizeof(float)));
+		default:
+			return hash_mix(h);
+	}
+}
+
 /*------------------------------------------------------------------------------
 	INI MANIPULATION
 ------------------------------------------------------------------------------*/
 
+static INI_STRVIEW view_make(const char* str, size_t len)
+{
+	INI_STRVIEW v;
+	v.str = str;
+	v.len = len;
+	return v;
+}
+
+static int view_equals(INI_STRVIEW v, const char* str)
+{
+	return strlen(str) == v.len && memcmp(v.str, str, v.len) == 0;
+}
+
+static void view_copy(char* dst, size_t dst_size, INI_STRVIEW v)
+{
+	size_t len = v.len < dst_size - 1 ? v.len : dst_size - 1;
+	memcpy(dst, v.str, len);
+	dst[len] = '\0';
+}
+
+static void key_free_val(INI_KEY* key)
+{
+	if (key->t_val == KVAL_TYPE_INT_ARRAY) {
+		free(key->iarr.data);
+	} else if (key->t_val == KVAL_TYPE_FLOAT_ARRAY) {
+		free(key->farr.data);
+	}
+	key->t_val = KVAL_TYPE_UNDEFINED;
+}
+
 static void key_set_i(INI_KEY* key, int val)
 {
+	key_free_val(key);
 	key->ival = val;
 	key->t_val = KVAL_TYPE_INT;
 }
 
 static void key_set_f(INI_KEY* key, float val)
 {
+	key_free_val(key);
 	key->fval = val;
 	key->t_val = KVAL_TYPE_FLOAT;
 }
 
 static void key_set_str(INI_KEY* key, const char* val)
 {
+	key_free_val(key);
 	strcpy_s(key->sval, INI_STR_MAX_LENGTH, val);
 	key->t_val = KVAL_TYPE_STR;
+	key->has_refs = strstr(key->sval, "${") != NULL;
+	free(key->xval);
+	key->xval = NULL;
+}
+
+/* room for count elements, even when there are none */
+static void* array_alloc(size_t count, size_t elem_size)
+{
+	void* data = malloc(count > 0 ? count * elem_size : 1);
+	alloc_check(data, "array: malloc failed\n");
+	return data;
+}
+
+static void* array_dup(const void* vals, size_t count, size_t elem_size)
+{
+	void* data = array_alloc(count, elem_size);
+	if (count > 0) {
+		memcpy(data, vals, count * elem_size);
+	}
+	return data;
+}
+
+/* the arrays take ownership of data */
+static void key_set_iv(INI_KEY* key, int* data, size_t count)
+{
+	key_free_val(key);
+	key->iarr.data = data;
+	key->iarr.count = count;
+	key->t_val = KVAL_TYPE_INT_ARRAY;
+}
+
+static void key_set_fv(INI_KEY* key, float* data, size_t count)
+{
+	key_free_val(key);
+	key->farr.data = data;
+	key->farr.count = count;
+	key->t_val = KVAL_TYPE_FLOAT_ARRAY;
+}
+
+static void key_copy_val(INI_KEY* dst, const INI_KEY* src)
+{
+	switch (src->t_val) {
+		case KVAL_TYPE_INT:
+			key_set_i(dst, src->ival);
+			break;
+		case KVAL_TYPE_FLOAT:
+			key_set_f(dst, src->fval);
+			break;
+		case KVAL_TYPE_STR:
+			key_set_str(dst, src->sval);
+			break;
+		case KVAL_TYPE_INT_ARRAY:
+			key_set_iv(dst, array_dup(src->iarr.data, src->iarr.count, sizeof(int)),
+				src->iarr.count);
+			break;
+		case KVAL_TYPE_FLOAT_ARRAY:
+			key_set_fv(dst, array_dup(src->farr.data, src->farr.count, sizeof(float)),
+				src->farr.count);
+			break;
+		default:
+			key_free_val(dst);
+			break;
+	}
 }
 
 static INI_KEY* key_create(const char* name)
 {
-	INI_KEY* key = malloc(sizeof(INI_KEY));
+	size_t name_size = strlen(name) + 1;
+	if (name_size > INI_STR_MAX_LENGTH) name_size = INI_STR_MAX_LENGTH;
+	INI_KEY* key = malloc(sizeof(INI_KEY) + name_size);
 	alloc_check(key, "key creation: malloc failed\n");
-	strcpy_s(key->key_name, INI_STR_MAX_LENGTH, name);
+	key->key_name = (char*)(key + 1);
+	strcpy_s(key->key_name, name_size, name);
 	key->t_val = KVAL_TYPE_UNDEFINED;
+	key->has_refs = 0;
+	key->resolving = 0;
+	key->xval = NULL;
+	key->xval_gen = 0;
 	return key;
 }
 
 static void key_destroy(INI_KEY* key)
 {
+	key_free_val(key);
+	free(key->xval);
 	free(key);
 }
 
@@ -115,7 +407,7 @@ static void sec_destroy(INI_SECTION* sec)
 
 static void sec_add_key(INI_SECTION* sec, INI_KEY* key)
 {
-	sec->keys = realloc(sec->keys, sizeof(INI_KEY));
+	sec->keys = realloc(sec->keys, (sec->keys_count + 1) * sizeof(INI_KEY*));
 	alloc_check(sec->keys, "adding a key: realloc failed\n");
 	sec->keys[sec->keys_count] = key;
 	sec->keys_count++;
@@ -139,11 +431,27 @@ INI* ini_create(void)
 	alloc_check(ini, "ini initialization: malloc failed\n");
 	ini->secs = NULL;
 	ini->secs_count = 0;
+	ini->generation = 0;
+	ini->interpolate = 0;
+	ini->block = NULL;
+	ini->block_size = 0;
+	ini->fingerprint = 0;
+	ini->source_fingerprint = 0;
 	return ini;
 }
 
 void ini_destroy(INI* ini)
 {
+	if (ini->block) {
+		foreach_section(ini) {
+			foreach_key(sec) {
+				free(key->xval);
+			}
+		}
+		free(ini->block);
+		free(ini);
+		return;
+	}
 	for (int i = ini->secs_count - 1; i >= 0; i--) {
 		sec_destroy(ini->secs[i]);
 	}
@@ -153,7 +461,7 @@ void ini_destroy(INI* ini)
 
 static void ini_add_sec(INI* ini, INI_SECTION* sec)
 {
-	ini->secs = realloc(ini->secs, sizeof(INI_SECTION));
+	ini->secs = realloc(ini->secs, (ini->secs_count + 1) * sizeof(INI_SECTION*));
 	alloc_check(ini->secs, "adding a section: realloc failed\n");
 	ini->secs[ini->secs_count] = sec;
 	ini->secs_count++;
@@ -171,9 +479,28 @@ static INI_SECTION* ini_get_section(INI* ini, const char* sec_name)
 	return NULL;
 }
 
+static void ini_touch(INI* ini)
+{
+	ini->generation++;
+}
+
+static void ini_uncompact(INI* ini);
+
+static void ini_track_add(INI* ini, const char* sec_name, const INI_KEY* key)
+{
+	ini->fingerprint += key_fingerprint(sec_name, key);
+}
+
+static void ini_track_remove(INI* ini, const char* sec_name, const INI_KEY* key)
+{
+	ini->fingerprint -= key_fingerprint(sec_name, key);
+}
+
 static void ini_add_key_generic(INI* ini, const char* sec_name,
 	const char* key_name, INI_KEY* key)
 {
+	ini_uncompact(ini);
+	ini_touch(ini);
 	INI_SECTION* sec = ini_get_section(ini, sec_name);
 	if (sec) {
 		sec_add_key(sec, key);
@@ -182,6 +509,7 @@ static void ini_add_key_generic(INI* ini, const char* sec_name,
 		sec_add_key(sec, key);
 		ini_add_sec(ini, sec);
 	}
+	ini_track_add(ini, sec->sec_name, key);
 }
 
 void ini_add_key_i(INI* ini, const char* sec_name, const char* key_name,
@@ -208,6 +536,40 @@ void ini_add_key_str(INI* ini, const char* sec_name, const char* key_name,
 	ini_add_key_generic(ini, sec_name, key_name, key);
 }
 
+void ini_add_key_iv(INI* ini, const char* sec_name, const char* key_name,
+	const int* vals, size_t count)
+{
+	INI_KEY* key = key_create(key_name);
+	key_set_iv(key, array_dup(vals, count, sizeof(int)), count);
+	ini_add_key_generic(ini, sec_name, key_name, key);
+}
+
+void ini_add_key_fv(INI* ini, const char* sec_name, const char* key_name,
+	const float* vals, size_t count)
+{
+	INI_KEY* key = key_create(key_name);
+	key_set_fv(key, array_dup(vals, count, sizeof(float)), count);
+	ini_add_key_generic(ini, sec_name, key_name, key);
+}
+
+void ini_remove_key(INI* ini, const char* sec_name, const char* key_name)
+{
+	ini_uncompact(ini);
+	INI_SECTION* sec = ini_get_section(ini, sec_name);
+	if (!sec) return;
+	for (int i = 0; i < sec->keys_count; i++) {
+		if (strcmp(sec->keys[i]->key_name, key_name) == 0) {
+			ini_track_remove(ini, sec->sec_name, sec->keys[i]);
+			key_destroy(sec->keys[i]);
+			memmove(&sec->keys[i], &sec->keys[i + 1],
+				(sec->keys_count - i - 1) * sizeof(INI_KEY*));
+			sec->keys_count--;
+			ini_touch(ini);
+			return;
+		}
+	}
+}
+
 int ini_does_key_exist(INI* ini, const char* sec_name, const char* key_name)
 {
 	INI_SECTION* sec = ini_get_section(ini, sec_name);
@@ -220,6 +582,136 @@ int ini_does_key_exist(INI* ini, const char* sec_name, const char* key_name)
 	return 0;
 }
 
+void ini_set_interpolation(INI* ini, int enable)
+{
+	ini->interpolate = enable;
+}
+
+#define REF_CYCLIC		-1
+#define REF_UNRESOLVED	0
+#define REF_RESOLVED	1
+
+static int key_interpolate(INI* ini, INI_SECTION* sec, INI_KEY* key);
+
+/* format any key's value the way it would appear inside a string */
+static int key_format(INI* ini, INI_SECTION* sec, INI_KEY* key, char* out_buff,
+	size_t buff_size)
+{
+	const char* str = key->sval;
+	switch (key->t_val) {
+		case KVAL_TYPE_INT:
+			snprintf(out_buff, buff_size, "%i", key->ival);
+			return REF_RESOLVED;
+		case KVAL_TYPE_FLOAT:
+			snprintf(out_buff, buff_size, "%f", key->fval);
+			return REF_RESOLVED;
+		case KVAL_TYPE_STR:
+			if (ini->interpolate && key->has_refs) {
+				if (!key_interpolate(ini, sec, key)) return REF_CYCLIC;
+				str = key->xval;
+			}
+			strcpy_s(out_buff, buff_size, str);
+			return REF_RESOLVED;
+		case KVAL_TYPE_UNDEFINED:
+		default:
+			return REF_UNRESOLVED;
+	}
+}
+
+/* resolve a "Section:key" or "key" (same section) reference */
+static int key_resolve_ref(INI* ini, INI_SECTION* sec, const char* ref,
+	char* out_buff, size_t buff_size)
+{
+	char sec_name[INI_STR_MAX_LENGTH];
+	const char* key_name = ref;
+	const char* colon = strrchr(ref, ':');
+	if (colon) {
+		view_copy(sec_name, INI_STR_MAX_LENGTH, view_make(ref, colon - ref));
+		key_name = colon + 1;
+		sec = ini_get_section(ini, sec_name);
+		if (!sec) return REF_UNRESOLVED;
+	}
+	INI_KEY* key = sec_get_key(sec, key_name);
+	if (!key) return REF_UNRESOLVED;
+	return key_format(ini, sec, key, out_buff, buff_size);
+}
+
+/* returns 0 when some reference was kept as it is because it leads into a cycle */
+static int key_expand(INI* ini, INI_SECTION* sec, INI_KEY* key, char* out_buff,
+	size_t buff_size)
+{
+	char ref[INI_STR_MAX_LENGTH];
+	char val[INI_STR_MAX_LENGTH];
+	const char* p = key->sval;
+	size_t len = 0;
+	int acyclic = 1;
+	while (*p && len < buff_size - 1) {
+		const char* end;
+		if (p[0] == '$' && p[1] == '{' && (end = strchr(p + 2, '}')) != NULL) {
+			view_copy(ref, INI_STR_MAX_LENGTH, view_make(p + 2, end - (p + 2)));
+			int res = key_resolve_ref(ini, sec, ref, val, INI_STR_MAX_LENGTH);
+			if (res == REF_RESOLVED) {
+				for (const char* v = val; *v && len < buff_size - 1; v++) {
+					out_buff[len++] = *v;
+				}
+				p = end + 1;
+				continue;
+			}
+			if (res == REF_CYCLIC) {
+				acyclic = 0;
+			}
+		}
+		/* unresolved references are kept as they are */
+		out_buff[len++] = *p++;
+	}
+	out_buff[len] = '\0';
+	return acyclic;
+}
+
+/*
+ * Expand a key's references into its xval. The expansion is memoized until the
+ * ini changes again, unless the key is part of or depends on a cycle: then the
+ * references leading into it are kept as they are and the expansion is redone
+ * on every access, so that the outcome doesn't depend on the order of reads.
+ * Returns 0 in that case, or when the key is already being expanded.
+ */
+static int key_interpolate(INI* ini, INI_SECTION* sec, INI_KEY* key)
+{
+	if (key->resolving) {
+		return 0;
+	}
+	if (key->xval && key->xval_gen == ini->generation) {
+		return 1;
+	}
+
+	char buff[INI_STR_MAX_LENGTH];
+	key->resolving = 1;
+	int acyclic = key_expand(ini, sec, key, buff, INI_STR_MAX_LENGTH);
+	key->resolving = 0;
+
+	if (!key->xval) {
+		key->xval = malloc(INI_STR_MAX_LENGTH);
+		alloc_check(key->xval, "interpolation: malloc failed\n");
+	}
+	strcpy_s(key->xval, INI_STR_MAX_LENGTH, buff);
+	/* a stale stamp keeps a cyclic expansion from being reused */
+	key->xval_gen = acyclic ? ini->generation : ini->generation - 1;
+	return acyclic;
+}
+
+/*
+ * Get the string value of a key, expanding its references when interpolation
+ * is enabled.
+ */
+static const char* key_get_str(INI* ini, INI_SECTION* sec, INI_KEY* key)
+{
+	if (!ini->interpolate || !key->has_refs) {
+		return key->sval;
+	}
+	key_interpolate(ini, sec, key);
+	return key->xval;
+}
+
 int ini_get_key_i(INI* ini, const char* sec_name, const char* key_name)
 {
 	INI_SECTION* sec = ini_get_section(ini, sec_name);
@@ -239,180 +731,2033 @@ void ini_get_key_str(INI* ini, const char* sec_name, const char* key_name,
 {
 	INI_SECTION* sec = ini_get_section(ini, sec_name);
 	INI_KEY* key = sec_get_key(sec, key_name);
-	strcpy_s(out_buff, buff_size, key->sval);
+	strcpy_s(out_buff, buff_size, key_get_str(ini, sec, key));
+}
+
+const int* ini_get_key_iv(INI* ini, const char* sec_name, const char* key_name,
+	size_t* out_count)
+{
+	INI_SECTION* sec = ini_get_section(ini, sec_name);
+	INI_KEY* key = sec_get_key(sec, key_name);
+	if (key->t_val != KVAL_TYPE_INT_ARRAY) {
+		*out_count = 0;
+		return NULL;
+	}
+	*out_count = key->iarr.count;
+	return key->iarr.data;
+}
+
+const float* ini_get_key_fv(INI* ini, const char* sec_name, const char* key_name,
+	size_t* out_count)
+{
+	INI_SECTION* sec = ini_get_section(ini, sec_name);
+	INI_KEY* key = sec_get_key(sec, key_name);
+	if (key->t_val != KVAL_TYPE_FLOAT_ARRAY) {
+		*out_count = 0;
+		return NULL;
+	}
+	*out_count = key->farr.count;
+	return key->farr.data;
 }
 
 /*------------------------------------------------------------------------------
-	SERIALIZATION
+	KEY INDEX
 ------------------------------------------------------------------------------*/
 
-#define foreach_section(ini) \
-	INI_SECTION* sec = ini->secs[0]; \
-	for (int isec = 0; isec < ini->secs_count; isec++, sec = ini->secs[isec])
+#define KEY_INDEX_MIN_SIZE	16
 
-#define foreach_key(sec) \
-	INI_KEY* key = sec->keys[0]; \
-	for (int ikey = 0; ikey < sec->keys_count; ikey++, key = sec->keys[ikey])
+/* open addressing hash table of (section, key) pairs, key is NULL for sections */
+typedef struct KEY_INDEX_ENTRY {
+	uint64_t hash;
+	INI_SECTION* sec;
+	INI_KEY* key;
+} KEY_INDEX_ENTRY;
 
-int ini_serialize(INI* ini, const char* path)
+typedef struct KEY_INDEX {
+	KEY_INDEX_ENTRY* entries;
+	size_t size;
+	size_t count;
+} KEY_INDEX;
+
+static void index_init(KEY_INDEX* idx)
 {
-	FILE* stream = fopen(path, "w");
-	if (!stream) return 0;
-	foreach_section(ini) {
-		if (sec->sec_name[0] != '\0') {
-			fprintf(stream, "[%s]\n", sec->sec_name);
+	idx->entries = NULL;
+	idx->size = 0;
+	idx->count = 0;
+}
+
+static void index_free(KEY_INDEX* idx)
+{
+	free(idx->entries);
+	index_init(idx);
+}
+
+static KEY_INDEX_ENTRY* index_find(KEY_INDEX* idx, uint64_t hash,
+	const char* sec_name, const char* key_name)
+{
+	if (idx->count == 0) return NULL;
+	size_t mask = idx->size - 1;
+	for (size_t i = (size_t)hash & mask; idx->entries[i].sec; i = (i + 1) & mask) {
+		KEY_INDEX_ENTRY* e = &idx->entries[i];
+		if (e->hash != hash || strcmp(e->sec->sec_name, sec_name) != 0) continue;
+		if (key_name ? (e->key && strcmp(e->key->key_name, key_name) == 0) : !e->key) {
+			return e;
 		}
-		foreach_key(sec) {
-			switch (key->t_val) {
-				case KVAL_TYPE_INT:
-					fprintf(stream, "%s=%i\n", key->key_name, key->ival);
-					break;
-				case KVAL_TYPE_FLOAT:
-					fprintf(stream, "%s=%f\n", key->key_name, key->fval);
-					break;
-				case KVAL_TYPE_STR:
-					fprintf(stream, "%s=%s\n", key->key_name, key->sval);
-					break;
-				case KVAL_TYPE_UNDEFINED:
-				default:
-					break;
+	}
+	return NULL;
+}
+
+static void index_put(KEY_INDEX_ENTRY* entries, size_t size, KEY_INDEX_ENTRY* e)
+{
+	size_t mask = size - 1;
+	size_t i = (size_t)e->hash & mask;
+	while (entries[i].sec) {
+		i = (i + 1) & mask;
+	}
+	entries[i] = *e;
+}
+
+static void index_insert(KEY_INDEX* idx, uint64_t hash, INI_SECTION* sec,
+	INI_KEY* key)
+{
+	/* keep the load factor under 1/2 */
+	if ((idx->count + 1) * 2 > idx->size) {
+		size_t size = idx->size ? idx->size * 2 : KEY_INDEX_MIN_SIZE;
+		KEY_INDEX_ENTRY* entries = calloc(size, sizeof(KEY_INDEX_ENTRY));
+		alloc_check(entries, "key index: calloc failed\n");
+		for (size_t i = 0; i < idx->size; i++) {
+			if (idx->entries[i].sec) {
+				index_put(entries, size, &idx->entries[i]);
 			}
 		}
-		fputc('\n', stream);
+		free(idx->entries);
+		idx->entries = entries;
+		idx->size = size;
 	}
-	fclose(stream);
-	return 1;
+
+	KEY_INDEX_ENTRY e;
+	e.hash = hash;
+	e.sec = sec;
+	e.key = key;
+	index_put(idx->entries, idx->size, &e);
+	idx->count++;
 }
 
 /*------------------------------------------------------------------------------
-	PARSING
+	OVERLAY
 ------------------------------------------------------------------------------*/
 
-#define getc_buffer(c, buff, pos) ((c) = (buff)[(pos)])
+#define OVERLAY_CACHE_MIN_SIZE	16
 
-static void parse_buffer_stream(INI* ini, const char* path, char** out_buff)
-{
-	FILE* stream = fopen(path, "r");
-	if (!stream) return;
+/* a lookup answered by one of the layers, or by none when key is NULL */
+typedef struct OVERLAY_ENTRY {
+	uint64_t hash;
+	INI* layer;		/* owns sec, for the interpolation */
+	INI_SECTION* sec;
+	INI_KEY* key;
+	char* miss_names;	/* misses only: "section\0key\0" */
+} OVERLAY_ENTRY;
+
+struct INI_OVERLAY {
+	INI** layers;
+	unsigned* layers_gen;
+	int layers_count;
+	/* open addressing hash table of the lookups, like KEY_INDEX */
+	OVERLAY_ENTRY* cache;
+	size_t cache_size;
+	size_t cache_count;
+};
 
-	fseek(stream, 0L, SEEK_END);
-	long fsize = ftell(stream);
-	rewind(stream);
+INI_OVERLAY* ini_overlay_create(void)
+{
+	INI_OVERLAY* ov = malloc(sizeof(INI_OVERLAY));
+	alloc_check(ov, "overlay initialization: malloc failed\n");
+	ov->layers = NULL;
+	ov->layers_gen = NULL;
+	ov->layers_count = 0;
+	ov->cache = NULL;
+	ov->cache_size = 0;
+	ov->cache_count = 0;
+	return ov;
+}
 
-	/* allocate memory for entire content */
-	*out_buff = calloc(sizeof(char), fsize + 1);
-	if (!*out_buff) {
-		fclose(stream);
-		fputs("memory alloc fails", stderr);
-		exit(EXIT_FAILURE);
+static void overlay_clear_cache(INI_OVERLAY* ov)
+{
+	if (ov->cache_count == 0) return;
+	for (size_t i = 0; i < ov->cache_size; i++) {
+		free(ov->cache[i].miss_names);
 	}
+	memset(ov->cache, 0, ov->cache_size * sizeof(OVERLAY_ENTRY));
+	ov->cache_count = 0;
+}
 
-	/* copy the file into the buffer */
-	fread(*out_buff, sizeof(char), fsize, stream);
+void ini_overlay_destroy(INI_OVERLAY* ov)
+{
+	overlay_clear_cache(ov);
+	free(ov->cache);
+	free(ov->layers_gen);
+	free(ov->layers);
+	free(ov);
+}
 
-	fclose(stream);
+void ini_overlay_push(INI_OVERLAY* ov, INI* layer)
+{
+	ov->layers = realloc(ov->layers, (ov->layers_count + 1) * sizeof(INI*));
+	alloc_check(ov->layers, "adding a layer: realloc failed\n");
+	ov->layers_gen = realloc(ov->layers_gen, (ov->layers_count + 1) * sizeof(unsigned));
+	alloc_check(ov->layers_gen, "adding a layer: realloc failed\n");
+	ov->layers[ov->layers_count] = layer;
+	ov->layers_gen[ov->layers_count] = layer->generation;
+	ov->layers_count++;
+	overlay_clear_cache(ov);
 }
 
-static void parse_key(INI* ini, char* buff, long* pos, INI_SECTION** last_sec)
+/* drop every cached lookup as soon as one of the layers has changed */
+static void overlay_validate_cache(INI_OVERLAY* ov)
 {
-	if (!(*last_sec)) {
-		*last_sec = sec_create("");
-		ini_add_sec(ini, *last_sec);
+	int changed = 0;
+	for (int i = 0; i < ov->layers_count; i++) {
+		if (ov->layers_gen[i] != ov->layers[i]->generation) {
+			ov->layers_gen[i] = ov->layers[i]->generation;
+			changed = 1;
+		}
 	}
-
-	char key_name[INI_STR_MAX_LENGTH] = "";
-	int keypos = 0;
-	char c;
-	while (getc_buffer(c, buff, *pos) != '=') {
-		key_name[keypos] = c;
-		keypos++;
-		(*pos)++;
+	if (changed) {
+		overlay_clear_cache(ov);
 	}
-	key_name[keypos] = '\0';
-	(*pos)++;
-
-	INI_KEY* key = key_create(key_name);
-
-	long valpos = 0;
-	memset(key_name, 0, INI_STR_MAX_LENGTH);
+}
 
-	int is_str = 0;
-	int is_float = 0;
-	while (getc_buffer(c, buff, *pos) != '\n') {
-		if (isspace(c) || isalpha(c)) is_str = 1;
-		if (c == '.') is_float = 1;
-		key_name[valpos] = c;
-		valpos++;
-		(*pos)++;
+static int overlay_entry_matches(const OVERLAY_ENTRY* e, const char* sec_name,
+	const char* key_name)
+{
+	if (e->key) {
+		return strcmp(e->sec->sec_name, sec_name) == 0 &&
+			strcmp(e->key->key_name, key_name) == 0;
 	}
-	key_name[valpos] = '\0';
+	const char* miss_key = e->miss_names + strlen(e->miss_names) + 1;
+	return strcmp(e->miss_names, sec_name) == 0 && strcmp(miss_key, key_name) == 0;
+}
 
-	if (is_str) {
-		key_set_str(key, key_name);
-	} else if (is_float) {
-		key_set_f(key, (float)atof(key_name));
-	} else {
-		key_set_i(key, atoi(key_name));
+static OVERLAY_ENTRY* overlay_find(INI_OVERLAY* ov, uint64_t hash,
+	const char* sec_name, const char* key_name)
+{
+	if (ov->cache_count == 0) return NULL;
+	size_t mask = ov->cache_size - 1;
+	for (size_t i = (size_t)hash & mask; ov->cache[i].sec || ov->cache[i].miss_names;
+		i = (i + 1) & mask) {
+		OVERLAY_ENTRY* e = &ov->cache[i];
+		if (e->hash == hash && overlay_entry_matches(e, sec_name, key_name)) {
+			return e;
+		}
 	}
-	sec_add_key(*last_sec, key);
+	return NULL;
 }
 
-static INI_SECTION* parse_section(INI* ini, char* buff, long* pos)
+static OVERLAY_ENTRY* overlay_put(OVERLAY_ENTRY* entries, size_t size,
+	OVERLAY_ENTRY* e)
 {
-	/* parse section name */
-	char sec_name[INI_STR_MAX_LENGTH] = "";
-	int secpos = 0;
-	char c;
-	while (getc_buffer(c, buff, *pos) != ']') {
-		sec_name[secpos] = c;
-		secpos++;
-		(*pos)++;
+	size_t mask = size - 1;
+	size_t i = (size_t)e->hash & mask;
+	while (entries[i].sec || entries[i].miss_names) {
+		i = (i + 1) & mask;
 	}
-	sec_name[secpos] = '\0';
-	(*pos)++;
-
-	/* set section */
-	INI_SECTION* sec = sec_create(sec_name);
-	ini_add_sec(ini, sec);
-	return sec;
+	entries[i] = *e;
+	return &entries[i];
 }
 
-int ini_parse(INI* ini, const char* path)
+static OVERLAY_ENTRY* overlay_insert(INI_OVERLAY* ov, OVERLAY_ENTRY* e)
 {
-	char* buffer;
-	parse_buffer_stream(ini, path, &buffer);
+	/* keep the load factor under 1/2 */
+	if ((ov->cache_count + 1) * 2 > ov->cache_size) {
+		size_t size = ov->cache_size ? ov->cache_size * 2 : OVERLAY_CACHE_MIN_SIZE;
+		OVERLAY_ENTRY* entries = calloc(size, sizeof(OVERLAY_ENTRY));
+		alloc_check(entries, "overlay cache: calloc failed\n");
+		for (size_t i = 0; i < ov->cache_size; i++) {
+			if (ov->cache[i].sec || ov->cache[i].miss_names) {
+				overlay_put(entries, size, &ov->cache[i]);
+			}
+		}
+		free(ov->cache);
+		ov->cache = entries;
+		ov->cache_size = size;
+	}
+	ov->cache_count++;
+	return overlay_put(ov->cache, ov->cache_size, e);
+}
 
-	INI_SECTION* last_sec = NULL;
+/*
+ * Remember that no layer has the key, so that asking again costs a single
+ * probe. Only the two names are kept, back to back.
+ */
+static void overlay_cache_miss(INI_OVERLAY* ov, uint64_t hash,
+	const char* sec_name, const char* key_name)
+{
+	size_t sec_size = strlen(sec_name) + 1;
+	size_t key_size = strlen(key_name) + 1;
+	OVERLAY_ENTRY e;
+	e.hash = hash;
+	e.layer = NULL;
+	e.sec = NULL;
+	e.key = NULL;
+	e.miss_names = malloc(sec_size + key_size);
+	alloc_check(e.miss_names, "overlay cache: malloc failed\n");
+	memcpy(e.miss_names, sec_name, sec_size);
+	memcpy(e.miss_names + sec_size, key_name, key_size);
+	overlay_insert(ov, &e);
+}
+
+/* the entry of the layer answering, NULL when none does */
+static OVERLAY_ENTRY* overlay_lookup(INI_OVERLAY* ov, const char* sec_name,
+	const char* key_name)
+{
+	overlay_validate_cache(ov);
+
+	uint64_t hash = hash_entry(sec_name, key_name);
+	OVERLAY_ENTRY* found = overlay_find(ov, hash, sec_name, key_name);
+	if (found) {
+		return found->key ? found : NULL;
+	}
+
+	for (int i = ov->layers_count - 1; i >= 0; i--) {
+		INI_SECTION* sec = ini_get_section(ov->layers[i], sec_name);
+		if (!sec) continue;
+		INI_KEY* key = sec_get_key(sec, key_name);
+		if (key) {
+			OVERLAY_ENTRY e;
+			e.hash = hash;
+			e.layer = ov->layers[i];
+			e.sec = sec;
+			e.key = key;
+			e.miss_names = NULL;
+			return overlay_insert(ov, &e);
+		}
+	}
+	overlay_cache_miss(ov, hash, sec_name, key_name);
+	return NULL;
+}
+
+static INI_KEY* overlay_get_key(INI_OVERLAY* ov, const char* sec_name,
+	const char* key_name)
+{
+	OVERLAY_ENTRY* e = overlay_lookup(ov, sec_name, key_name);
+	return e ? e->key : NULL;
+}
+
+int ini_overlay_does_key_exist(INI_OVERLAY* ov, const char* sec_name,
+	const char* key_name)
+{
+	return overlay_get_key(ov, sec_name, key_name) != NULL;
+}
+
+int ini_overlay_get_key_i(INI_OVERLAY* ov, const char* sec_name,
+	const char* key_name)
+{
+	INI_KEY* key = overlay_get_key(ov, sec_name, key_name);
+	return key ? key->ival : 0;
+}
+
+float ini_overlay_get_key_f(INI_OVERLAY* ov, const char* sec_name,
+	const char* key_name)
+{
+	INI_KEY* key = overlay_get_key(ov, sec_name, key_name);
+	return key ? key->fval : 0.0f;
+}
+
+void ini_overlay_get_key_str(INI_OVERLAY* ov, const char* sec_name,
+	const char* key_name, char* out_buff, size_t buff_size)
+{
+	/* interpolated within the layer answering, like ini_get_key_str() */
+	OVERLAY_ENTRY* e = overlay_lookup(ov, sec_name, key_name);
+	strcpy_s(out_buff, buff_size, e ? key_get_str(e->layer, e->sec, e->key) : "");
+}
+
+/*------------------------------------------------------------------------------
+	DIFF AND MERGE
+------------------------------------------------------------------------------*/
+
+/*
+ * The changes are stored in a plain INI, with one section per kind of change
+ * and section name, e.g. the keys added to "Paths". The kinds are kept aside,
+ * so any valid section name fits. In files the kind prefixes the section
+ * name instead: "[+Paths]".
+ */
+struct INI_DIFF {
+	INI* changes;
+	char* secs_kind;	/* the kind of each section of changes */
+	INI_SECTION** entries_sec;
+	INI_KEY** entries_key;
+	char* entries_kind;
+	int entries_count;
+};
+
+static int key_equals(const INI_KEY* a, const INI_KEY* b)
+{
+	if (a->t_val != b->t_val) return 0;
+	switch (a->t_val) {
+		case KVAL_TYPE_INT:
+			return a->ival == b->ival;
+		case KVAL_TYPE_FLOAT:
+			return memcmp(&a->fval, &b->fval, sizeof(float)) == 0;
+		case KVAL_TYPE_STR:
+			return strcmp(a->sval, b->sval) == 0;
+		case KVAL_TYPE_INT_ARRAY:
+			return a->iarr.count == b->iarr.count &&
+				memcmp(a->iarr.data, b->iarr.data, a->iarr.count * sizeof(int)) == 0;
+		case KVAL_TYPE_FLOAT_ARRAY:
+			return a->farr.count == b->farr.count &&
+				memcmp(a->farr.data, b->farr.data, a->farr.count * sizeof(float)) == 0;
+		default:
+			return 1;
+	}
+}
+
+/*
+ * Index the sections and keys visible through lookups: only the first section
+ * with a given name and the first key with a given name inside it.
+ */
+static void index_build(KEY_INDEX* idx, INI* ini)
+{
+	index_init(idx);
+	foreach_section(ini) {
+		uint64_t hash = hash_entry(sec->sec_name, NULL);
+		if (index_find(idx, hash, sec->sec_name, NULL)) continue;
+		index_insert(idx, hash, sec, NULL);
+		foreach_key(sec) {
+			hash = hash_entry(sec->sec_name, key->key_name);
+			if (!index_find(idx, hash, sec->sec_name, key->key_name)) {
+				index_insert(idx, hash, sec, key);
+			}
+		}
+	}
+}
+
+/* whether the key is the one returned by lookups */
+static int index_is_visible(KEY_INDEX* idx, INI_SECTION* sec, INI_KEY* key)
+{
+	KEY_INDEX_ENTRY* e = index_find(idx, hash_entry(sec->sec_name, key->key_name),
+		sec->sec_name, key->key_name);
+	return e && e->key == key;
+}
+
+static void diff_build_entries(INI_DIFF* diff)
+{
+	free(diff->entries_sec);
+	free(diff->entries_key);
+	free(diff->entries_kind);
+	diff->entries_sec = NULL;
+	diff->entries_key = NULL;
+	diff->entries_kind = NULL;
+	diff->entries_count = 0;
+
+	int count = 0;
+	foreach_section(diff->changes) {
+		count += sec->keys_count;
+	}
+	diff->entries_sec = malloc(count * sizeof(INI_SECTION*) + 1);
+	alloc_check(diff->entries_sec, "diff entries: malloc failed\n");
+	diff->entries_key = malloc(count * sizeof(INI_KEY*) + 1);
+	alloc_check(diff->entries_key, "diff entries: malloc failed\n");
+	diff->entries_kind = malloc(count + 1);
+	alloc_check(diff->entries_kind, "diff entries: malloc failed\n");
+
+	foreach_section(diff->changes) {
+		foreach_key(sec) {
+			diff->entries_sec[diff->entries_count] = sec;
+			diff->entries_key[diff->entries_count] = key;
+			diff->entries_kind[diff->entries_count] = diff->secs_kind[isec];
+			diff->entries_count++;
+		}
+	}
+}
+
+static INI_SECTION* diff_add_sec(INI_DIFF* diff, char op, const char* sec_name)
+{
+	INI_SECTION* sec = sec_create(sec_name);
+	ini_add_sec(diff->changes, sec);
+	diff->secs_kind = realloc(diff->secs_kind, diff->changes->secs_count);
+	alloc_check(diff->secs_kind, "diff section: realloc failed\n");
+	diff->secs_kind[diff->changes->secs_count - 1] = op;
+	return sec;
+}
+
+/* keys come grouped by section, so only the last section of each kind is reused */
+static void diff_add(INI_DIFF* diff, INI_SECTION** last_sec, char op,
+	const char* sec_name, const INI_KEY* src)
+{
+	if (!*last_sec || strcmp((*last_sec)->sec_name, sec_name) != 0) {
+		*last_sec = diff_add_sec(diff, op, sec_name);
+	}
+
+	INI_KEY* key = key_create(src->key_name);
+	if (op == INI_DIFF_REMOVED) {
+		key_set_str(key, "");
+	} else {
+		key_copy_val(key, src);
+	}
+	sec_add_key(*last_sec, key);
+}
+
+INI_DIFF* ini_diff_create(void)
+{
+	INI_DIFF* diff = malloc(sizeof(INI_DIFF));
+	alloc_check(diff, "diff initialization: malloc failed\n");
+	diff->changes = ini_create();
+	diff->secs_kind = NULL;
+	diff->entries_sec = NULL;
+	diff->entries_key = NULL;
+	diff->entries_kind = NULL;
+	diff->entries_count = 0;
+	return diff;
+}
+
+void ini_diff_destroy(INI_DIFF* diff)
+{
+	free(diff->secs_kind);
+	free(diff->entries_sec);
+	free(diff->entries_key);
+	free(diff->entries_kind);
+	ini_destroy(diff->changes);
+	free(diff);
+}
+
+INI_DIFF* ini_diff(INI* a, INI* b)
+{
+	INI_DIFF* diff = ini_diff_create();
+
+	KEY_INDEX a_idx;
+	KEY_INDEX b_idx;
+	index_build(&a_idx, a);
+	index_build(&b_idx, b);
+
+	INI_SECTION* last_removed = NULL;
+	INI_SECTION* last_changed = NULL;
+	INI_SECTION* last_added = NULL;
+
+	foreach_section(a) {
+		foreach_key(sec) {
+			if (!index_is_visible(&a_idx, sec, key)) continue;
+			KEY_INDEX_ENTRY* e = index_find(&b_idx,
+				hash_entry(sec->sec_name, key->key_name), sec->sec_name, key->key_name);
+			if (!e) {
+				diff_add(diff, &last_removed, INI_DIFF_REMOVED, sec->sec_name, key);
+			} else if (!key_equals(key, e->key)) {
+				diff_add(diff, &last_changed, INI_DIFF_CHANGED, sec->sec_name, e->key);
+			}
+		}
+	}
+	foreach_section(b) {
+		foreach_key(sec) {
+			if (!index_is_visible(&b_idx, sec, key)) continue;
+			if (!index_find(&a_idx, hash_entry(sec->sec_name, key->key_name),
+				sec->sec_name, key->key_name)) {
+				diff_add(diff, &last_added, INI_DIFF_ADDED, sec->sec_name, key);
+			}
+		}
+	}
+
+	index_free(&a_idx);
+	index_free(&b_idx);
+	diff_build_entries(diff);
+	return diff;
+}
+
+int ini_diff_count(INI_DIFF* diff)
+{
+	return diff->entries_count;
+}
+
+int ini_diff_get(INI_DIFF* diff, int idx, const char** sec_name,
+	const char** key_name)
+{
+	*sec_name = diff->entries_sec[idx]->sec_name;
+	*key_name = diff->entries_key[idx]->key_name;
+	return diff->entries_kind[idx];
+}
+
+/* remove the keys marked as KVAL_TYPE_REMOVED and the sections left empty */
+static void ini_sweep(INI* ini)
+{
+	int secs_count = 0;
+	foreach_section(ini) {
+		int keys_count = 0;
+		foreach_key(sec) {
+			if (key->t_val == KVAL_TYPE_REMOVED) {
+				key_destroy(key);
+			} else {
+				sec->keys[keys_count++] = key;
+			}
+		}
+		int emptied = keys_count == 0 && sec->keys_count > 0;
+		sec->keys_count = keys_count;
+		if (emptied) {
+			sec_destroy(sec);
+		} else {
+			ini->secs[secs_count++] = sec;
+		}
+	}
+	ini->secs_count = secs_count;
+}
+
+/* add src to dst or overwrite the existing key, keeping the index updated */
+static void merge_key(INI* dst, KEY_INDEX* idx, const char* sec_name,
+	const INI_KEY* src, int overwrite)
+{
+	uint64_t hash = hash_entry(sec_name, src->key_name);
+	KEY_INDEX_ENTRY* e = index_find(idx, hash, sec_name, src->key_name);
+	if (e && e->key->t_val == KVAL_TYPE_REMOVED) {
+		/* removed earlier in the same pass, its fingerprint is already gone */
+		key_copy_val(e->key, src);
+		ini_track_add(dst, sec_name, e->key);
+		return;
+	}
+	if (e) {
+		if (overwrite && !key_equals(e->key, src)) {
+			ini_track_remove(dst, sec_name, e->key);
+			key_copy_val(e->key, src);
+			ini_track_add(dst, sec_name, e->key);
+		}
+		return;
+	}
+
+	uint64_t sec_hash = hash_entry(sec_name, NULL);
+	e = index_find(idx, sec_hash, sec_name, NULL);
+	INI_SECTION* sec;
+	if (e) {
+		sec = e->sec;
+	} else {
+		sec = sec_create(sec_name);
+		ini_add_sec(dst, sec);
+		index_insert(idx, sec_hash, sec, NULL);
+	}
+	INI_KEY* key = key_create(src->key_name);
+	key_copy_val(key, src);
+	sec_add_key(sec, key);
+	index_insert(idx, hash, sec, key);
+	ini_track_add(dst, sec_name, key);
+}
+
+int ini_merge(INI* dst, INI* src, int policy)
+{
+	ini_uncompact(dst);
+	KEY_INDEX dst_idx;
+	KEY_INDEX src_idx;
+	index_build(&dst_idx, dst);
+	index_build(&src_idx, src);
+
+	if (policy == INI_MERGE_MIRROR) {
+		foreach_section(dst) {
+			foreach_key(sec) {
+				if (index_is_visible(&dst_idx, sec, key) &&
+					!index_find(&src_idx, hash_entry(sec->sec_name, key->key_name),
+						sec->sec_name, key->key_name)) {
+					ini_track_remove(dst, sec->sec_name, key);
+					key_free_val(key);
+					key->t_val = KVAL_TYPE_REMOVED;
+				}
+			}
+		}
+	}
+
+	foreach_section(src) {
+		foreach_key(sec) {
+			if (index_is_visible(&src_idx, sec, key)) {
+				merge_key(dst, &dst_idx, sec->sec_name, key, policy != INI_MERGE_KEEP);
+			}
+		}
+	}
+
+	index_free(&dst_idx);
+	index_free(&src_idx);
+	ini_sweep(dst);
+	ini_touch(dst);
+	return 1;
+}
+
+int ini_merge_diff(INI* dst, INI_DIFF* diff)
+{
+	ini_uncompact(dst);
+	KEY_INDEX dst_idx;
+	index_build(&dst_idx, dst);
+
+	for (int i = 0; i < diff->entries_count; i++) {
+		const char* sec_name = diff->entries_sec[i]->sec_name;
+		INI_KEY* key = diff->entries_key[i];
+		if (diff->entries_kind[i] == INI_DIFF_REMOVED) {
+			KEY_INDEX_ENTRY* e = index_find(&dst_idx,
+				hash_entry(sec_name, key->key_name), sec_name, key->key_name);
+			/* appended diffs may remove the same key twice */
+			if (e && e->key->t_val != KVAL_TYPE_REMOVED) {
+				ini_track_remove(dst, sec_name, e->key);
+				key_free_val(e->key);
+				e->key->t_val = KVAL_TYPE_REMOVED;
+			}
+		} else {
+			merge_key(dst, &dst_idx, sec_name, key, 1);
+		}
+	}
+
+	index_free(&dst_idx);
+	ini_sweep(dst);
+	ini_touch(dst);
+	return 1;
+}
+
+/*------------------------------------------------------------------------------
+	COMPACTION
+------------------------------------------------------------------------------*/
+
+#define COMPACT_ALIGN	8
+
+static size_t align_up(size_t size)
+{
+	return (size + COMPACT_ALIGN - 1) & ~(size_t)(COMPACT_ALIGN - 1);
+}
+
+/* bytes of a section record up to the end of its name */
+static size_t sec_used_size(const INI_SECTION* sec)
+{
+	return offsetof(INI_SECTION, sec_name) + strlen(sec->sec_name) + 1;
+}
+
+/* bytes of a key record up to the end of its value */
+static size_t key_value_size(const INI_KEY* key)
+{
+	size_t size = offsetof(INI_KEY, ival);
+	switch (key->t_val) {
+		case KVAL_TYPE_INT:
+			return size + sizeof(key->ival);
+		case KVAL_TYPE_FLOAT:
+			return size + sizeof(key->fval);
+		case KVAL_TYPE_STR:
+			return size + strlen(key->sval) + 1;
+		case KVAL_TYPE_INT_ARRAY:
+			return size + sizeof(key->iarr);
+		case KVAL_TYPE_FLOAT_ARRAY:
+			return size + sizeof(key->farr);
+		default:
+			return size;
+	}
+}
+
+/* the value followed by the name */
+static size_t key_used_size(const INI_KEY* key)
+{
+	return key_value_size(key) + strlen(key->key_name) + 1;
+}
+
+static size_t key_array_size(const INI_KEY* key)
+{
+	if (key->t_val == KVAL_TYPE_INT_ARRAY) {
+		return key->iarr.count * sizeof(int);
+	} else if (key->t_val == KVAL_TYPE_FLOAT_ARRAY) {
+		return key->farr.count * sizeof(float);
+	}
+	return 0;
+}
+
+void ini_compact(INI* ini)
+{
+	size_t size = align_up(ini->secs_count * sizeof(INI_SECTION*));
+	foreach_section(ini) {
+		size += align_up(sec_used_size(sec));
+		size += align_up(sec->keys_count * sizeof(INI_KEY*));
+		foreach_key(sec) {
+			size += align_up(key_used_size(key));
+			size += align_up(key_array_size(key));
+		}
+	}
+
+	char* block = malloc(size + 1);
+	alloc_check(block, "compaction: malloc failed\n");
+
+	/* every section is followed by its keys, in iteration order */
+	char* p = block;
+	INI_SECTION** secs = (INI_SECTION**)p;
+	p += align_up(ini->secs_count * sizeof(INI_SECTION*));
+	foreach_section(ini) {
+		INI_SECTION* new_sec = (INI_SECTION*)p;
+		memcpy(new_sec, sec, sec_used_size(sec));
+		p += align_up(sec_used_size(sec));
+		new_sec->keys = (INI_KEY**)p;
+		p += align_up(sec->keys_count * sizeof(INI_KEY*));
+		foreach_key(sec) {
+			/* the interpolation memo moves along with the key */
+			INI_KEY* new_key = (INI_KEY*)p;
+			size_t value_size = key_value_size(key);
+			memcpy(new_key, key, value_size);
+			new_key->key_name = p + value_size;
+			memcpy(new_key->key_name, key->key_name, strlen(key->key_name) + 1);
+			p += align_up(key_used_size(key));
+			if (key->t_val == KVAL_TYPE_INT_ARRAY || key->t_val == KVAL_TYPE_FLOAT_ARRAY) {
+				/* empty arrays too, their old buffer is freed below */
+				memcpy(p, key->iarr.data, key_array_size(key));
+				new_key->iarr.data = (int*)p;
+				p += align_up(key_array_size(key));
+			}
+			new_sec->keys[ikey] = new_key;
+		}
+		secs[isec] = new_sec;
+	}
+
+	if (ini->block) {
+		free(ini->block);
+	} else {
+		foreach_section(ini) {
+			foreach_key(sec) {
+				key_free_val(key);
+				free(key);
+			}
+			free(sec->keys);
+			free(sec);
+		}
+		free(ini->secs);
+	}
+	ini->secs = secs;
+	ini->block = block;
+	ini->block_size = size;
+	ini_touch(ini);
+}
+
+/* go back to individually allocated records before any change */
+static void ini_uncompact(INI* ini)
+{
+	if (!ini->block) return;
+
+	INI_SECTION** secs = malloc(ini->secs_count * sizeof(INI_SECTION*) + 1);
+	alloc_check(secs, "uncompaction: malloc failed\n");
+	foreach_section(ini) {
+		INI_SECTION* new_sec = sec_create(sec->sec_name);
+		new_sec->keys = malloc(sec->keys_count * sizeof(INI_KEY*) + 1);
+		alloc_check(new_sec->keys, "uncompaction: malloc failed\n");
+		new_sec->keys_count = sec->keys_count;
+		foreach_key(sec) {
+			INI_KEY* new_key = key_create(key->key_name);
+			key_copy_val(new_key, key);
+			new_key->xval = key->xval;
+			new_key->xval_gen = key->xval_gen;
+			new_sec->keys[ikey] = new_key;
+		}
+		secs[isec] = new_sec;
+	}
+
+	free(ini->block);
+	ini->block = NULL;
+	ini->block_size = 0;
+	ini->secs = secs;
+	ini_touch(ini);
+}
+
+void ini_memory_usage(INI* ini, INI_MEMORY_USAGE* usage)
+{
+	memset(usage, 0, sizeof(INI_MEMORY_USAGE));
+	int compact = ini->block != NULL;
+
+	usage->indices_used = ini->secs_count * sizeof(INI_SECTION*);
+	usage->indices_reserved = compact ? align_up(usage->indices_used) : usage->indices_used;
+	foreach_section(ini) {
+		size_t used = sec_used_size(sec);
+		usage->sections_used += used;
+		usage->sections_reserved += compact ? align_up(used) : sizeof(INI_SECTION);
+
+		used = sec->keys_count * sizeof(INI_KEY*);
+		usage->indices_used += used;
+		usage->indices_reserved += compact ? align_up(used) : used;
+
+		foreach_key(sec) {
+			used = key_used_size(key);
+			usage->keys_used += used;
+			usage->keys_reserved += compact ? align_up(used) :
+				sizeof(INI_KEY) + strlen(key->key_name) + 1;
+
+			used = key_array_size(key);
+			usage->arrays_used += used;
+			usage->arrays_reserved += compact ? align_up(used) : used;
+
+			if (key->xval) {
+				usage->memos_used += strlen(key->xval) + 1;
+				usage->memos_reserved += INI_STR_MAX_LENGTH;
+			}
+		}
+	}
+
+	usage->total_used = usage->sections_used + usage->keys_used +
+		usage->arrays_used + usage->indices_used + usage->memos_used;
+	usage->total_reserved = usage->sections_reserved + usage->keys_reserved +
+		usage->arrays_reserved + usage->indices_reserved + usage->memos_reserved;
+}
+
+/*------------------------------------------------------------------------------
+	SERIALIZATION
+------------------------------------------------------------------------------*/
+
+#define FLOAT_MAX_LENGTH	64	/* FLT_MAX and the smallest subnormal written out in full */
+
+/*
+ * Arrays are written as comma separated lists. A single element gets a
+ * trailing comma and an empty array is a lone comma, so that they can't be
+ * mistaken for scalars when parsed back. An empty float array is ".," to keep
+ * its type.
+ */
+static void serialize_iv(FILE* stream, const int* data, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (i > 0) fputc(',', stream);
+		fprintf(stream, "%i", data[i]);
+	}
+	if (count < 2) fputc(',', stream);
+}
+
+/*
+ * Shortest representation which reads back to the same float. Scalars can't
+ * use the exponent form, they would be parsed back as strings.
+ */
+static void format_float(char* out_buff, size_t buff_size, float val, int allow_exp)
+{
+	for (int prec = 6; prec <= 9; prec++) {
+		snprintf(out_buff, buff_size, "%.*g", prec, val);
+		if (strtof(out_buff, NULL) == val) break;
+	}
+	if (allow_exp || !strpbrk(out_buff, "eE")) return;
+	for (int prec = 1; prec <= 50; prec++) {
+		snprintf(out_buff, buff_size, "%.*f", prec, val);
+		if (strtof(out_buff, NULL) == val) break;
+	}
+}
+
+static void serialize_fv(FILE* stream, const float* data, size_t count)
+{
+	char buff[FLOAT_MAX_LENGTH];
+	for (size_t i = 0; i < count; i++) {
+		if (i > 0) fputc(',', stream);
+		format_float(buff, FLOAT_MAX_LENGTH, data[i], 1);
+		fputs(buff, stream);
+		/* keep it a float array when parsed back, "nan" and "inf" already are */
+		if (!strpbrk(buff, ".eEn")) fputs(".0", stream);
+	}
+	if (count == 0) fputc('.', stream);
+	if (count < 2) fputc(',', stream);
+}
+
+/* quoted strings can't be mistaken for numbers or arrays, diffs need that */
+static void serialize_keys(FILE* stream, INI_SECTION* sec, int quote_strings)
+{
+	char buff[FLOAT_MAX_LENGTH];
+	foreach_key(sec) {
+		switch (key->t_val) {
+			case KVAL_TYPE_INT:
+				fprintf(stream, "%s=%i\n", key->key_name, key->ival);
+				break;
+			case KVAL_TYPE_FLOAT:
+				format_float(buff, FLOAT_MAX_LENGTH, key->fval, 0);
+				/* keep it a float when parsed back */
+				fprintf(stream, "%s=%s%s\n", key->key_name, buff,
+					strpbrk(buff, ".n") ? "" : ".0");
+				break;
+			case KVAL_TYPE_STR:
+				if (quote_strings) {
+					fprintf(stream, "%s=\"%s\"\n", key->key_name, key->sval);
+				} else {
+					fprintf(stream, "%s=%s\n", key->key_name, key->sval);
+				}
+				break;
+			case KVAL_TYPE_INT_ARRAY:
+				fprintf(stream, "%s=", key->key_name);
+				serialize_iv(stream, key->iarr.data, key->iarr.count);
+				fputc('\n', stream);
+				break;
+			case KVAL_TYPE_FLOAT_ARRAY:
+				fprintf(stream, "%s=", key->key_name);
+				serialize_fv(stream, key->farr.data, key->farr.count);
+				fputc('\n', stream);
+				break;
+			case KVAL_TYPE_UNDEFINED:
+			default:
+				break;
+		}
+	}
+	fputc('\n', stream);
+}
+
+int ini_serialize(INI* ini, const char* path)
+{
+	FILE* stream = fopen(path, "w");
+	if (!stream) return 0;
+	foreach_section(ini) {
+		if (sec->sec_name[0] != '\0') {
+			fprintf(stream, "[%s]\n", sec->sec_name);
+		}
+		serialize_keys(stream, sec, 0);
+	}
+	fclose(stream);
+	return 1;
+}
+
+int ini_diff_serialize(INI_DIFF* diff, const char* path)
+{
+	FILE* stream = fopen(path, "w");
+	if (!stream) return 0;
+	foreach_section(diff->changes) {
+		fprintf(stream, "[%c%s]\n", diff->secs_kind[isec], sec->sec_name);
+		serialize_keys(stream, sec, 1);
+	}
+	fclose(stream);
+	return 1;
+}
+
+/*------------------------------------------------------------------------------
+	PARSING
+------------------------------------------------------------------------------*/
+
+#define PARSE_CHUNK_SIZE	4096
+
+/* buffered line reader, only keeps the longest line in memory */
+typedef struct PARSE_READER {
+	FILE* stream;
+	char* buff;
+	size_t buff_size;
+	size_t len;
+	size_t pos;
+	int eof;
+	HASH_STREAM hash;	/* of everything read so far */
+} PARSE_READER;
+
+static void reader_open(PARSE_READER* r, FILE* stream)
+{
+	r->stream = stream;
+	r->buff = malloc(PARSE_CHUNK_SIZE);
+	alloc_check(r->buff, "parsing: malloc failed\n");
+	r->buff_size = PARSE_CHUNK_SIZE;
+	r->len = 0;
+	r->pos = 0;
+	r->eof = 0;
+	hash_stream_init(&r->hash);
+}
+
+static void reader_close(PARSE_READER* r)
+{
+	free(r->buff);
+	fclose(r->stream);
+}
+
+static int reader_next_line(PARSE_READER* r, const char** line, size_t* line_len)
+{
+	for (;;) {
+		char* start = r->buff + r->pos;
+		size_t avail = r->len - r->pos;
+		char* nl = memchr(start, '\n', avail);
+		if (nl) {
+			*line = start;
+			*line_len = nl - start;
+			r->pos += *line_len + 1;
+			return 1;
+		}
+		if (r->eof) {
+			if (avail == 0) return 0;
+			*line = start;
+			*line_len = avail;
+			r->pos = r->len;
+			return 1;
+		}
+
+		/* move the partial line at the front and read some more */
+		memmove(r->buff, start, avail);
+		r->len = avail;
+		r->pos = 0;
+		if (r->buff_size - r->len < PARSE_CHUNK_SIZE) {
+			r->buff_size *= 2;
+			r->buff = realloc(r->buff, r->buff_size);
+			alloc_check(r->buff, "parsing: realloc failed\n");
+		}
+		size_t n = fread(r->buff + r->len, sizeof(char), r->buff_size - r->len, r->stream);
+		hash_stream_update(&r->hash, r->buff + r->len, n);
+		r->len += n;
+		if (n == 0) r->eof = 1;
+	}
+}
+
+/* hash whatever hasn't been read yet */
+static void reader_drain(PARSE_READER* r)
+{
+	size_t n;
+	while ((n = fread(r->buff, sizeof(char), r->buff_size, r->stream)) > 0) {
+		hash_stream_update(&r->hash, r->buff, n);
+	}
+	r->len = 0;
+	r->pos = 0;
+	r->eof = 1;
+}
+
+/* strip the '\r' left behind by CRLF line endings */
+static size_t line_trim_cr(const char* line, size_t len)
+{
+	return (len > 0 && line[len - 1] == '\r') ? len - 1 : len;
+}
+
+/* out_hash, if any, receives the fingerprint of the file's raw bytes on success */
+static int parse_file(const char* path, const INI_PARSE_CALLBACKS* cbs,
+	void* user, uint64_t* out_hash)
+{
+	FILE* stream = fopen(path, "rb");
+	if (!stream) return 0;
+
+	PARSE_READER reader;
+	reader_open(&reader, stream);
+
+	char sec_buff[INI_STR_MAX_LENGTH] = "";
+	INI_STRVIEW sec_name = view_make(sec_buff, 0);
+	int skip = 0;
+	int res = 1;
+
+	const char* line;
+	size_t len;
+	while (reader_next_line(&reader, &line, &len)) {
+		len = line_trim_cr(line, len);
+		size_t pos = 0;
+		while (pos < len && isspace((unsigned char)line[pos])) {
+			pos++;
+		}
+		if (pos == len) continue;
+
+		char c = line[pos];
+		if (c == '[') {
+			pos++;
+			const char* end = memchr(line + pos, ']', len - pos);
+			if (!end) {
+				res = 0;
+				break;
+			}
+			INI_STRVIEW name = view_make(line + pos, end - (line + pos));
+			view_copy(sec_buff, INI_STR_MAX_LENGTH, name);
+			sec_name.len = strlen(sec_buff);
+			skip = 0;
+			if (cbs->on_section) {
+				int r = cbs->on_section(user, name);
+				if (r == INI_PARSE_STOP) break;
+				skip = (r == INI_PARSE_SKIP);
+			}
+		} else if (skip) {
+			/* fast path: nothing but section headers matter here */
+			continue;
+		} else if (c == ';') {
+			pos++;
+			if (cbs->on_comment &&
+				cbs->on_comment(user, view_make(line + pos, len - pos)) == INI_PARSE_STOP) {
+				break;
+			}
+		} else if (isalpha((unsigned char)c)) {
+			const char* eq = memchr(line + pos, '=', len - pos);
+			if (!eq) {
+				res = 0;
+				break;
+			}
+			INI_STRVIEW key_name = view_make(line + pos, eq - (line + pos));
+			INI_STRVIEW val = view_make(eq + 1, (line + len) - (eq + 1));
+			if (cbs->on_key &&
+				cbs->on_key(user, sec_name, key_name, val) == INI_PARSE_STOP) {
+				break;
+			}
+		} else if (iscntrl((unsigned char)c)) {
+			break;
+		} else {
+			res = 0;
+			break;
+		}
+	}
+
+	if (res && out_hash) {
+		reader_drain(&reader);
+		*out_hash = hash_stream_final(&reader.hash);
+	}
+	reader_close(&reader);
+	return res;
+}
+
+int ini_parse_cb(const char* path, const INI_PARSE_CALLBACKS* cbs, void* user)
+{
+	return parse_file(path, cbs, user, NULL);
+}
+
+static const double pow10_table[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char* skip_blanks(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+	return p;
+}
+
+/* returns where the number ends or NULL when malformed */
+static const char* parse_number_i(const char* p, const char* end, int* out)
+{
+	int neg = 0;
+	if (p < end && (*p == '-' || *p == '+')) {
+		neg = (*p == '-');
+		p++;
+	}
+	const char* digits = p;
+	long long val = 0;
+	while (p < end && (unsigned)(*p - '0') < 10) {
+		val = val * 10 + (*p - '0');
+		if (val > 2147483648LL) return NULL;
+		p++;
+	}
+	if (p == digits) return NULL;
+	val = neg ? -val : val;
+	if (val > 2147483647LL) return NULL;
+	*out = (int)val;
+	return p;
+}
+
+/* case insensitive match of a lowercase word, returns where it ends */
+static const char* match_word(const char* p, const char* end, const char* word)
+{
+	for (; *word; p++, word++) {
+		if (p == end || tolower((unsigned char)*p) != *word) return NULL;
+	}
+	return p;
+}
+
+static const char* parse_number_f(const char* p, const char* end, float* out)
+{
+	int neg = 0;
+	if (p < end && (*p == '-' || *p == '+')) {
+		neg = (*p == '-');
+		p++;
+	}
+
+	/* the non-finite values written by serialize_fv() */
+	const char* word;
+	if ((word = match_word(p, end, "nan")) != NULL) {
+		*out = neg ? -NAN : NAN;
+		return word;
+	}
+	if ((word = match_word(p, end, "inf")) != NULL) {
+		const char* longer = match_word(word, end, "inity");
+		*out = neg ? -INFINITY : INFINITY;
+		return longer ? longer : word;
+	}
+
+	/* accumulate up to 19 significant digits in an integer mantissa */
+	uint64_t mantissa = 0;
+	int ndigits = 0;
+	int exp = 0;
+	int seen = 0;
+	for (; p < end && (unsigned)(*p - '0') < 10; p++, seen = 1) {
+		if (ndigits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa) ndigits++;
+		} else {
+			exp++;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && (unsigned)(*p - '0') < 10; p++, seen = 1) {
+			if (ndigits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) ndigits++;
+				exp--;
+			}
+		}
+	}
+	if (!seen) return NULL;
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		int e = 0;
+		p = parse_number_i(p + 1, end, &e);
+		if (!p || e > 4096 || e < -4096) return NULL;
+		exp += e;
+	}
+
+	double val = (double)mantissa;
+	for (; exp > 22; exp -= 22) val *= 1e22;
+	for (; exp < -22; exp += 22) val /= 1e22;
+	val = (exp >= 0) ? val * pow10_table[exp] : val / pow10_table[-exp];
+	*out = (float)(neg ? -val : val);
+	return p;
+}
+
+/*
+ * Parse a comma separated list of numbers into a contiguous buffer. The
+ * elements are counted first (memchr() is vectorized by most libcs) so the
+ * buffer is allocated once, then the numbers are parsed in a single pass.
+ */
+static int key_parse_array(INI_KEY* key, INI_STRVIEW val)
+{
+	const char* p = val.str;
+	const char* end = val.str + val.len;
+
+	size_t count = 1;
+	for (const char* c = memchr(p, ',', val.len); c; c = memchr(c + 1, ',', end - c - 1)) {
+		count++;
+	}
+	/* 'n' and 'N' stand for nan and inf */
+	int is_float = memchr(p, '.', val.len) || memchr(p, 'e', val.len) ||
+		memchr(p, 'E', val.len) || memchr(p, 'n', val.len) || memchr(p, 'N', val.len);
+	size_t elem_size = is_float ? sizeof(float) : sizeof(int);
 
-	long pos = 0;
-	char c;
-	while (getc_buffer(c, buffer, pos) != EOF) {
-		if (isspace(c)) {
-			pos++;
-			continue;
+	char* data = array_alloc(count, elem_size);
+
+	size_t n = 0;
+	p = skip_blanks(p, end);
+	/* empty array, "," or ".," for floats */
+	const char* comma = (p < end && *p == '.') ? skip_blanks(p + 1, end) : p;
+	if (comma < end && *comma == ',' && skip_blanks(comma + 1, end) == end) {
+		p = end;
+	}
+	while (p < end) {
+		p = is_float ? parse_number_f(p, end, (float*)data + n)
+			: parse_number_i(p, end, (int*)data + n);
+		if (!p) {
+			free(data);
+			return 0;
+		}
+		n++;
+		p = skip_blanks(p, end);
+		if (p == end) break;
+		if (*p != ',') {
+			free(data);
+			return 0;
 		}
-		if (iscntrl(c)) {
+		/* a trailing comma is allowed */
+		p = skip_blanks(p + 1, end);
+	}
+
+	if (is_float) {
+		key_set_fv(key, (float*)data, n);
+	} else {
+		key_set_iv(key, (int*)data, n);
+	}
+	return 1;
+}
+
+/* state used to materialize the callbacks into an INI */
+typedef struct PARSE_CTX {
+	INI* ini;
+	INI_SECTION* last_sec;
+	const char** names;
+	size_t names_count;
+	int all_sections;	/* names is ignored, set by ini_parse() */
+	int skip_global;
+} PARSE_CTX;
+
+static int parse_wants_section(PARSE_CTX* ctx, INI_STRVIEW sec_name)
+{
+	if (ctx->all_sections) return 1;
+	for (size_t i = 0; i < ctx->names_count; i++) {
+		if (view_equals(sec_name, ctx->names[i])) {
 			return 1;
 		}
+	}
+	return 0;
+}
 
-		if (c == ';') {
-			pos++;
-			while (getc_buffer(c, buffer, pos) != '\n') {
-				if (iscntrl(c)) {
-					return 1;
+static int parse_on_section(void* user, INI_STRVIEW sec_name)
+{
+	PARSE_CTX* ctx = user;
+	if (!parse_wants_section(ctx, sec_name)) {
+		return INI_PARSE_SKIP;
+	}
+
+	char name[INI_STR_MAX_LENGTH];
+	view_copy(name, INI_STR_MAX_LENGTH, sec_name);
+	ctx->last_sec = sec_create(name);
+	ini_add_sec(ctx->ini, ctx->last_sec);
+	ini_touch(ctx->ini);
+	return INI_PARSE_CONTINUE;
+}
+
+static void parse_add_key(PARSE_CTX* ctx, INI_KEY* key)
+{
+	sec_add_key(ctx->last_sec, key);
+	ini_track_add(ctx->ini, ctx->last_sec->sec_name, key);
+	ini_touch(ctx->ini);
+}
+
+static int parse_on_key(void* user, INI_STRVIEW sec_name, INI_STRVIEW key_name,
+	INI_STRVIEW val)
+{
+	(void)sec_name;	/* ctx->last_sec already is that section */
+	PARSE_CTX* ctx = user;
+	if (!ctx->last_sec) {
+		/* keys before any section header belong to the global section */
+		if (ctx->skip_global) return INI_PARSE_CONTINUE;
+		ctx->last_sec = sec_create("");
+		ini_add_sec(ctx->ini, ctx->last_sec);
+	}
+
+	char buff[INI_STR_MAX_LENGTH];
+	view_copy(buff, INI_STR_MAX_LENGTH, key_name);
+	INI_KEY* key = key_create(buff);
+
+	if (memchr(val.str, ',', val.len) && key_parse_array(key, val)) {
+		parse_add_key(ctx, key);
+		return INI_PARSE_CONTINUE;
+	}
+
+	int is_str = 0;
+	int is_float = 0;
+	for (size_t i = 0; i < val.len; i++) {
+		unsigned char c = val.str[i];
+		if (isspace(c) || isalpha(c)) is_str = 1;
+		if (c == '.') is_float = 1;
+	}
+	view_copy(buff, INI_STR_MAX_LENGTH, val);
+
+	if (is_str) {
+		key_set_str(key, buff);
+	} else if (is_float) {
+		key_set_f(key, strtof(buff, NULL));
+	} else {
+		key_set_i(key, atoi(buff));
+	}
+	parse_add_key(ctx, key);
+	return INI_PARSE_CONTINUE;
+}
+
+static int parse_ini(INI* ini, const char* path, const char** names,
+	size_t names_count, int all_sections)
+{
+	ini_uncompact(ini);
+
+	PARSE_CTX ctx;
+	ctx.ini = ini;
+	ctx.last_sec = NULL;
+	ctx.names = names;
+	ctx.names_count = names ? names_count : 0;
+	ctx.all_sections = all_sections;
+	ctx.skip_global = !parse_wants_section(&ctx, view_make("", 0));
+
+	INI_PARSE_CALLBACKS cbs;
+	cbs.on_section = parse_on_section;
+	cbs.on_key = parse_on_key;
+	cbs.on_comment = NULL;
+
+	uint64_t hash;
+	int res = parse_file(path, &cbs, &ctx, &hash);
+	if (res) {
+		ini->source_fingerprint = hash;
+	}
+	return res;
+}
+
+/* the kind of change prefixes each section of a serialized diff */
+typedef struct DIFF_PARSE_CTX {
+	PARSE_CTX parse;	/* first, parse_on_key() gets a pointer to the whole */
+	INI_DIFF* diff;
+	int too_long;
+} DIFF_PARSE_CTX;
+
+static int diff_parse_on_section(void* user, INI_STRVIEW sec_name)
+{
+	DIFF_PARSE_CTX* ctx = user;
+	char op = sec_name.len > 0 ? sec_name.str[0] : '\0';
+	if (op != INI_DIFF_ADDED && op != INI_DIFF_REMOVED && op != INI_DIFF_CHANGED) {
+		ctx->parse.last_sec = NULL;
+		return INI_PARSE_SKIP;
+	}
+	/* a longer name can't come from ini_diff_serialize() */
+	if (sec_name.len > INI_STR_MAX_LENGTH) {
+		ctx->too_long = 1;
+		return INI_PARSE_STOP;
+	}
+
+	char name[INI_STR_MAX_LENGTH];
+	view_copy(name, INI_STR_MAX_LENGTH, view_make(sec_name.str + 1, sec_name.len - 1));
+	ctx->parse.last_sec = diff_add_sec(ctx->diff, op, name);
+	return INI_PARSE_CONTINUE;
+}
+
+/*
+ * Values keep the type they had when serialized: strings are quoted and any
+ * float is read as such, including nan and inf.
+ */
+static int diff_parse_on_key(void* user, INI_STRVIEW sec_name,
+	INI_STRVIEW key_name, INI_STRVIEW val)
+{
+	DIFF_PARSE_CTX* ctx = user;
+	if (!ctx->parse.last_sec || memchr(val.str, ',', val.len)) {
+		return parse_on_key(user, sec_name, key_name, val);
+	}
+
+	char buff[INI_STR_MAX_LENGTH];
+	view_copy(buff, INI_STR_MAX_LENGTH, key_name);
+	INI_KEY* key = key_create(buff);
+
+	const char* end = val.str + val.len;
+	char num[INI_STR_MAX_LENGTH];
+	char* num_end;
+	view_copy(num, INI_STR_MAX_LENGTH, val);
+	float fval = strtof(num, &num_end);
+	int ival;
+	if (val.len >= 2 && val.str[0] == '"' && end[-1] == '"') {
+		view_copy(buff, INI_STR_MAX_LENGTH, view_make(val.str + 1, val.len - 2));
+		key_set_str(key, buff);
+	} else if (parse_number_i(val.str, end, &ival) == end) {
+		key_set_i(key, ival);
+	} else if (*num && *num_end == '\0') {
+		key_set_f(key, fval);
+	} else {
+		/* written by hand */
+		key_destroy(key);
+		return parse_on_key(user, sec_name, key_name, val);
+	}
+	parse_add_key(&ctx->parse, key);
+	return INI_PARSE_CONTINUE;
+}
+
+int ini_diff_parse(INI_DIFF* diff, const char* path)
+{
+	DIFF_PARSE_CTX ctx;
+	ctx.parse.ini = diff->changes;
+	ctx.parse.last_sec = NULL;
+	ctx.parse.names = NULL;
+	ctx.parse.names_count = 0;
+	ctx.parse.all_sections = 1;
+	ctx.parse.skip_global = 1;
+	ctx.diff = diff;
+	ctx.too_long = 0;
+
+	INI_PARSE_CALLBACKS cbs;
+	cbs.on_section = diff_parse_on_section;
+	cbs.on_key = diff_parse_on_key;
+	cbs.on_comment = NULL;
+
+	int res = parse_file(path, &cbs, &ctx, NULL);
+	diff_build_entries(diff);
+	return res && !ctx.too_long;
+}
+
+int ini_parse_sections(INI* ini, const char* path, const char** names,
+	size_t names_count)
+{
+	return parse_ini(ini, path, names, names_count, 0);
+}
+
+int ini_parse(INI* ini, const char* path)
+{
+	return parse_ini(ini, path, NULL, 0, 1);
+}
+
+/*------------------------------------------------------------------------------
+	FINGERPRINTING
+------------------------------------------------------------------------------*/
+
+#define FINGERPRINT_CHUNK_SIZE	65536
+
+INI_FINGERPRINT ini_fingerprint(INI* ini)
+{
+	return ini->fingerprint;
+}
+
+INI_FINGERPRINT ini_source_fingerprint(INI* ini)
+{
+	return ini->source_fingerprint;
+}
+
+int ini_file_fingerprint(const char* path, INI_FINGERPRINT* out_fp)
+{
+	FILE* stream = fopen(path, "rb");
+	if (!stream) return 0;
+
+	char* buff = malloc(FINGERPRINT_CHUNK_SIZE);
+	alloc_check(buff, "file fingerprint: malloc failed\n");
+
+	HASH_STREAM hs;
+	hash_stream_init(&hs);
+	size_t n;
+	while ((n = fread(buff, sizeof(char), FINGERPRINT_CHUNK_SIZE, stream)) > 0) {
+		hash_stream_update(&hs, buff, n);
+	}
+	int res = !ferror(stream);
+
+	free(buff);
+	fclose(stream);
+	if (res) {
+		*out_fp = hash_stream_final(&hs);
+	}
+	return res;
+}
+
+/*------------------------------------------------------------------------------
+	SHARED MEMORY
+------------------------------------------------------------------------------*/
+
+#ifdef INI_HAVE_SHM
+
+#define SHM_MAGIC			0x494e4931u
+#define SHM_NAME_MAX		256
+#define SHM_MAX_RETRIES		16
+#define SHM_MODE			0600	/* the values may be secrets */
+
+/*
+ * Published under the user's name, only tells which generation is current.
+ * Generation n is a separate read-only object named "<name>.<n>".
+ */
+typedef struct SHM_CONTROL {
+	uint32_t magic;
+	uint32_t version;
+	atomic_ullong generation;
+} SHM_CONTROL;
+
+/* shared between processes, so it must not hide a process local lock */
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared memory needs lock-free 64 bit atomics");
+
+/* every reference inside an image is an offset from its start */
+typedef struct SHM_HEADER {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;
+	uint64_t generation;
+	uint64_t fingerprint;
+	uint64_t keys_count;
+	uint64_t keys_off;
+	uint64_t table_size;	/* power of two */
+	uint64_t table_off;		/* slots hold a key index + 1, 0 is empty */
+} SHM_HEADER;
+
+typedef struct SHM_KEY {
+	uint64_t hash;
+	uint64_t sec_off;
+	uint64_t key_off;
+	int32_t t_val;
+	int32_t ival;
+	float fval;
+	uint64_t val_off;	/* strings and arrays */
+	uint64_t count;
+} SHM_KEY;
+
+struct INI_SHM {
+	char name[SHM_NAME_MAX];
+	SHM_CONTROL* control;
+	char* image;
+	size_t image_size;
+	uint64_t generation;
+};
+
+static void shm_image_name(char* out_buff, const char* name, uint64_t generation)
+{
+	snprintf(out_buff, SHM_NAME_MAX, "%s.%llu", name, (unsigned long long)generation);
+}
+
+/* bump allocator over the image, only measures when base is NULL */
+typedef struct SHM_WRITER {
+	char* base;
+	size_t pos;
+} SHM_WRITER;
+
+static uint64_t shm_put(SHM_WRITER* w, const void* data, size_t len)
+{
+	uint64_t off = w->pos;
+	if (w->base && len > 0) {
+		memcpy(w->base + off, data, len);
+	}
+	w->pos += align_up(len);
+	return off;
+}
+
+static size_t shm_build_image(INI* ini, KEY_INDEX* idx, char* base,
+	uint64_t generation)
+{
+	size_t keys_count = 0;
+	foreach_section(ini) {
+		foreach_key(sec) {
+			keys_count += index_is_visible(idx, sec, key);
+		}
+	}
+	size_t table_size = KEY_INDEX_MIN_SIZE;
+	while (table_size < keys_count * 2) {
+		table_size *= 2;
+	}
+
+	SHM_WRITER w;
+	w.base = base;
+	w.pos = align_up(sizeof(SHM_HEADER));
+	size_t keys_off = w.pos;
+	w.pos += align_up(keys_count * sizeof(SHM_KEY));
+	size_t table_off = w.pos;
+	w.pos += align_up(table_size * sizeof(uint32_t));
+
+	SHM_KEY* keys = base ? (SHM_KEY*)(base + keys_off) : NULL;
+	uint32_t* table = base ? (uint32_t*)(base + table_off) : NULL;
+	if (table) {
+		memset(table, 0, table_size * sizeof(uint32_t));
+	}
+
+	size_t n = 0;
+	foreach_section(ini) {
+		uint64_t sec_off = 0;
+		int sec_written = 0;
+		foreach_key(sec) {
+			if (!index_is_visible(idx, sec, key)) continue;
+			if (!sec_written) {
+				sec_off = shm_put(&w, sec->sec_name, strlen(sec->sec_name) + 1);
+				sec_written = 1;
+			}
+
+			SHM_KEY k;
+			memset(&k, 0, sizeof(SHM_KEY));
+			k.hash = hash_entry(sec->sec_name, key->key_name);
+			k.sec_off = sec_off;
+			k.key_off = shm_put(&w, key->key_name, strlen(key->key_name) + 1);
+			k.t_val = key->t_val;
+			const char* str;
+			switch (key->t_val) {
+				case KVAL_TYPE_INT:
+					k.ival = key->ival;
+					break;
+				case KVAL_TYPE_FLOAT:
+					k.fval = key->fval;
+					break;
+				case KVAL_TYPE_STR:
+					/* readers get the values already interpolated */
+					str = key_get_str(ini, sec, key);
+					k.count = strlen(str);
+					k.val_off = shm_put(&w, str, k.count + 1);
+					break;
+				case KVAL_TYPE_INT_ARRAY:
+				case KVAL_TYPE_FLOAT_ARRAY:
+					k.count = key->iarr.count;
+					k.val_off = shm_put(&w, key->iarr.data, key_array_size(key));
+					break;
+				default:
+					break;
+			}
+
+			if (base) {
+				keys[n] = k;
+				size_t mask = table_size - 1;
+				size_t i = (size_t)k.hash & mask;
+				while (table[i]) {
+					i = (i + 1) & mask;
 				}
-				pos++;
+				table[i] = (uint32_t)(n + 1);
 			}
-		} else if (isalpha(c)) {
-			parse_key(ini, buffer, &pos, &last_sec);
-		} else if (c == '[') {
-			pos++;
-			last_sec = parse_section(ini, buffer, &pos);
-		} else {
+			n++;
+		}
+	}
+
+	if (base) {
+		SHM_HEADER* hdr = (SHM_HEADER*)base;
+		hdr->magic = SHM_MAGIC;
+		hdr->version = INI_VERSION;
+		hdr->size = w.pos;
+		hdr->generation = generation;
+		hdr->fingerprint = ini->fingerprint;
+		hdr->keys_count = keys_count;
+		hdr->keys_off = keys_off;
+		hdr->table_size = table_size;
+		hdr->table_off = table_off;
+	}
+	return w.pos;
+}
+
+static int shm_write_image(INI* ini, const char* name, uint64_t generation)
+{
+	KEY_INDEX idx;
+	index_build(&idx, ini);
+	size_t size = shm_build_image(ini, &idx, NULL, generation);
+
+	/* never reuse a stale image, someone else may have created it */
+	char image_name[SHM_NAME_MAX];
+	shm_image_name(image_name, name, generation);
+	shm_unlink(image_name);
+	int fd = shm_open(image_name, O_RDWR | O_CREAT | O_EXCL, SHM_MODE);
+	if (fd < 0) {
+		index_free(&idx);
+		return 0;
+	}
+	char* base = MAP_FAILED;
+	if (ftruncate(fd, (off_t)size) == 0) {
+		base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (base == MAP_FAILED) {
+		shm_unlink(image_name);
+		index_free(&idx);
+		return 0;
+	}
+
+	shm_build_image(ini, &idx, base, generation);
+	munmap(base, size);
+	index_free(&idx);
+	return 1;
+}
+
+int ini_shm_publish(INI* ini, const char* name)
+{
+	if (strlen(name) + 22 > SHM_NAME_MAX) return 0;
+
+	int fd = shm_open(name, O_RDWR | O_CREAT, SHM_MODE);
+	if (fd < 0) return 0;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_uid != geteuid() ||
+		(st.st_size < (off_t)sizeof(SHM_CONTROL) && ftruncate(fd, sizeof(SHM_CONTROL)) != 0)) {
+		close(fd);
+		return 0;
+	}
+	SHM_CONTROL* control = mmap(NULL, sizeof(SHM_CONTROL), PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+	close(fd);
+	if (control == MAP_FAILED) return 0;
+
+	control->magic = SHM_MAGIC;
+	control->version = INI_VERSION;
+	uint64_t generation = atomic_load_explicit(&control->generation, memory_order_acquire) + 1;
+	int res = shm_write_image(ini, name, generation);
+	if (res) {
+		atomic_store_explicit(&control->generation, generation, memory_order_release);
+		/* readers still mapping the old image keep it alive until they switch */
+		if (generation > 1) {
+			char image_name[SHM_NAME_MAX];
+			shm_image_name(image_name, name, generation - 1);
+			shm_unlink(image_name);
+		}
+	}
+
+	munmap(control, sizeof(SHM_CONTROL));
+	return res;
+}
+
+int ini_shm_unlink(const char* name)
+{
+	INI_SHM* shm = ini_shm_attach(name);
+	if (shm) {
+		char image_name[SHM_NAME_MAX];
+		shm_image_name(image_name, name, shm->generation);
+		shm_unlink(image_name);
+		ini_shm_detach(shm);
+	}
+	return shm_unlink(name) == 0;
+}
+
+/* the elements fit in the image and are aligned the way shm_put() does */
+static int shm_check_span(size_t size, uint64_t off, uint64_t count, size_t elem_size)
+{
+	return off % COMPACT_ALIGN == 0 && off <= size && count <= (size - off) / elem_size;
+}
+
+static int shm_check_str(const char* image, size_t size, uint64_t off)
+{
+	return off < size && memchr(image + off, '\0', size - off) != NULL;
+}
+
+/* nothing in an image is trusted before every offset has been checked */
+static int shm_check_image(const char* image, size_t size)
+{
+	const SHM_HEADER* hdr = (const SHM_HEADER*)image;
+	if (!shm_check_span(size, hdr->keys_off, hdr->keys_count, sizeof(SHM_KEY)) ||
+		!shm_check_span(size, hdr->table_off, hdr->table_size, sizeof(uint32_t)) ||
+		hdr->table_size == 0 || (hdr->table_size & (hdr->table_size - 1)) != 0) {
+		return 0;
+	}
+
+	const SHM_KEY* keys = (const SHM_KEY*)(image + hdr->keys_off);
+	for (uint64_t i = 0; i < hdr->keys_count; i++) {
+		const SHM_KEY* key = &keys[i];
+		if (!shm_check_str(image, size, key->sec_off) ||
+			!shm_check_str(image, size, key->key_off)) {
 			return 0;
 		}
-		pos++;
+		int valid = 1;
+		switch (key->t_val) {
+			case KVAL_TYPE_STR:
+				valid = key->count < size &&
+					shm_check_span(size, key->val_off, key->count + 1, 1) &&
+					image[key->val_off + key->count] == '\0';
+				break;
+			case KVAL_TYPE_INT_ARRAY:
+				valid = shm_check_span(size, key->val_off, key->count, sizeof(int));
+				break;
+			case KVAL_TYPE_FLOAT_ARRAY:
+				valid = shm_check_span(size, key->val_off, key->count, sizeof(float));
+				break;
+			default:
+				break;
+		}
+		if (!valid) return 0;
+	}
+
+	/* every probe must end on an empty slot */
+	const uint32_t* table = (const uint32_t*)(image + hdr->table_off);
+	uint64_t used = 0;
+	for (uint64_t i = 0; i < hdr->table_size; i++) {
+		if (table[i] > hdr->keys_count) return 0;
+		used += table[i] != 0;
+	}
+	return used < hdr->table_size;
+}
+
+static int shm_map_generation(INI_SHM* shm, uint64_t generation)
+{
+	char image_name[SHM_NAME_MAX];
+	shm_image_name(image_name, shm->name, generation);
+	int fd = shm_open(image_name, O_RDONLY, 0);
+	if (fd < 0) return 0;
+
+	struct stat st;
+	char* image = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_uid == geteuid() &&
+		st.st_size >= (off_t)sizeof(SHM_HEADER)) {
+		image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (image == MAP_FAILED) return 0;
+
+	const SHM_HEADER* hdr = (const SHM_HEADER*)image;
+	if (hdr->magic != SHM_MAGIC || hdr->generation != generation ||
+		hdr->size > (uint64_t)st.st_size ||
+		!shm_check_image(image, (size_t)hdr->size)) {
+		munmap(image, (size_t)st.st_size);
+		return 0;
 	}
 
+	if (shm->image) {
+		munmap(shm->image, shm->image_size);
+	}
+	shm->image = image;
+	shm->image_size = (size_t)st.st_size;
+	shm->generation = generation;
 	return 1;
 }
+
+INI_SHM* ini_shm_attach(const char* name)
+{
+	if (strlen(name) + 22 > SHM_NAME_MAX) return NULL;
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) return NULL;
+	struct stat st;
+	SHM_CONTROL* control = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_uid == geteuid() &&
+		st.st_size >= (off_t)sizeof(SHM_CONTROL)) {
+		control = mmap(NULL, sizeof(SHM_CONTROL), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (control == MAP_FAILED) return NULL;
+
+	INI_SHM* shm = malloc(sizeof(INI_SHM));
+	alloc_check(shm, "shared memory attach: malloc failed\n");
+	strcpy_s(shm->name, SHM_NAME_MAX, name);
+	shm->control = control;
+	shm->image = NULL;
+	shm->image_size = 0;
+	shm->generation = 0;
+
+	ini_shm_refresh(shm);
+	if (!shm->image) {
+		ini_shm_detach(shm);
+		return NULL;
+	}
+	return shm;
+}
+
+void ini_shm_detach(INI_SHM* shm)
+{
+	if (shm->image) {
+		munmap(shm->image, shm->image_size);
+	}
+	munmap(shm->control, sizeof(SHM_CONTROL));
+	free(shm);
+}
+
+int ini_shm_refresh(INI_SHM* shm)
+{
+	for (int i = 0; i < SHM_MAX_RETRIES; i++) {
+		uint64_t generation = atomic_load_explicit(&shm->control->generation,
+			memory_order_acquire);
+		if (generation == 0 || (shm->image && generation == shm->generation)) {
+			return 0;
+		}
+		if (shm_map_generation(shm, generation)) {
+			return 1;
+		}
+		/* superseded and unlinked in the meantime, look again */
+	}
+	return 0;
+}
+
+unsigned long long ini_shm_generation(INI_SHM* shm)
+{
+	return shm->generation;
+}
+
+INI_FINGERPRINT ini_shm_fingerprint(INI_SHM* shm)
+{
+	return ((const SHM_HEADER*)shm->image)->fingerprint;
+}
+
+static const SHM_KEY* shm_get_key(INI_SHM* shm, const char* sec_name,
+	const char* key_name)
+{
+	const char* image = shm->image;
+	const SHM_HEADER* hdr = (const SHM_HEADER*)image;
+	const SHM_KEY* keys = (const SHM_KEY*)(image + hdr->keys_off);
+	const uint32_t* table = (const uint32_t*)(image + hdr->table_off);
+
+	uint64_t hash = hash_entry(sec_name, key_name);
+	size_t mask = (size_t)hdr->table_size - 1;
+	for (size_t i = (size_t)hash & mask; table[i]; i = (i + 1) & mask) {
+		const SHM_KEY* key = &keys[table[i] - 1];
+		if (key->hash == hash && strcmp(image + key->sec_off, sec_name) == 0 &&
+			strcmp(image + key->key_off, key_name) == 0) {
+			return key;
+		}
+	}
+	return NULL;
+}
+
+int ini_shm_does_key_exist(INI_SHM* shm, const char* sec_name,
+	const char* key_name)
+{
+	return shm_get_key(shm, sec_name, key_name) != NULL;
+}
+
+int ini_shm_get_key_i(INI_SHM* shm, const char* sec_name, const char* key_name)
+{
+	const SHM_KEY* key = shm_get_key(shm, sec_name, key_name);
+	return key ? key->ival : 0;
+}
+
+float ini_shm_get_key_f(INI_SHM* shm, const char* sec_name, const char* key_name)
+{
+	const SHM_KEY* key = shm_get_key(shm, sec_name, key_name);
+	return key ? key->fval : 0.0f;
+}
+
+void ini_shm_get_key_str(INI_SHM* shm, const char* sec_name,
+	const char* key_name, char* out_buff, size_t buff_size)
+{
+	const SHM_KEY* key = shm_get_key(shm, sec_name, key_name);
+	int is_str = key && key->t_val == KVAL_TYPE_STR;
+	strcpy_s(out_buff, buff_size, is_str ? shm->image + key->val_off : "");
+}
+
+const int* ini_shm_get_key_iv(INI_SHM* shm, const char* sec_name,
+	const char* key_name, size_t* out_count)
+{
+	const SHM_KEY* key = shm_get_key(shm, sec_name, key_name);
+	if (!key || key->t_val != KVAL_TYPE_INT_ARRAY) {
+		*out_count = 0;
+		return NULL;
+	}
+	*out_count = (size_t)key->count;
+	return (const int*)(shm->image + key->val_off);
+}
+
+const float* ini_shm_get_key_fv(INI_SHM* shm, const char* sec_name,
+	const char* key_name, size_t* out_count)
+{
+	const SHM_KEY* key = shm_get_key(shm, sec_name, key_name);
+	if (!key || key->t_val != KVAL_TYPE_FLOAT_ARRAY) {
+		*out_count = 0;
+		return NULL;
+	}
+	*out_count = (size_t)key->count;
+	return (const float*)(shm->image + key->val_off);
+}
+
+#endif /* INI_HAVE_SHM */